@@ -1,20 +1,145 @@
 #pragma once
-#include "Define.h"
+#include "EngineDefine.h"
 #include "SimpleState.cpp"
+#include "Playout.cpp"
+#include "NodeArena.cpp"
+#include "TranspositionTable.cpp"
+#include "ThreadPool.cpp"
+#include "SearchLimit.cpp"
+#include "EndgameSolver.cpp"
+#include "Evaluator.cpp"
+#include "OpeningBook.cpp"
+#include "LeafEvaluator.cpp"
+#include "PolicyValueNet.cpp"
+#include "SearchStats.cpp"
+#include <thread>
 
 class Agent {
 protected:
 	std::random_device rnd;
 	std::mt19937 mt;
+	std::atomic<bool> stop_flag;
+	SearchLimits limits;
+	std::unique_ptr<EndgameSolver> solver;
+	SolveResult last_solve;
+	int endgame_wld_empties;
+	int endgame_exact_empties;
+	const OpeningBook* book;
+	SearchStats stats;
+
+	// eG[WFg̎̑IѕBstats ̒TŗL̗͂Ŗ߂
+	virtual std::pair<int, int> think(SimpleState state) = 0;
+
+	SearchClock start_clock(const SimpleState& state) const {
+		return SearchClock(limits, state.empty_count());
+	}
+
+	// ΋ǂ̎ԂgB0 ͖̈ӖȂ̂ 1ms ͎c
+	void finish_clock(const SearchClock& clock) {
+		if (limits.game_time_ms > 0) {
+			limits.game_time_ms = std::max(1.0, limits.game_time_ms - clock.elapsed_ms());
+		}
+	}
+
+	// ǂݐ؂āAłȂ trueBȂ瑊̊ԈႢɊ҂ĕi̒TɔC
+	bool solve_endgame(const SimpleState& state, const SearchClock& clock) {
+		last_solve = SolveResult();
+		int empties = state.empty_count();
+		if (empties > endgame_wld_empties)return false;
+		if (!solver)solver = std::make_unique<EndgameSolver>();
+		SolveMode mode = empties <= endgame_exact_empties ? SolveMode::Exact : SolveMode::WinLossDraw;
+		last_solve = solver->solve(state, mode, [&]() {
+			return stop_requested() || clock.past_deadline();
+		});
+		if (last_solve.aborted)return false;
+		if (mode == SolveMode::WinLossDraw && last_solve.score < 0)return false;
+		stats.source = SearchStats::Source::Solver;
+		stats.nodes = last_solve.nodes;
+		stats.max_depth = empties;
+		stats.average_depth = empties;
+		return true;
+	}
+
+	// ՂɂǖʂȂ pos ɂ̎ true
+	bool probe_book(const SimpleState& state, int& pos) {
+		if (!book)return false;
+		pos = book->probe(state.get_player(), state.get_opponent());
+		if (pos < 0)return false;
+		last_solve = SolveResult();
+		stats.source = SearchStats::Source::Book;
+		return true;
+	}
 public:
-	Agent() :mt(rnd()) {}
-	virtual std::pair<int, int> select_action(SimpleState state) = 0;
+	Agent() :mt(rnd()), stop_flag(false), endgame_wld_empties(0), endgame_exact_empties(0), book(OpeningBook::shared()) {}
+	virtual ~Agent() {}
+
+	// IсAԂȂǂ get_last_stats Ō悤Ɏc
+	std::pair<int, int> select_action(SimpleState state) {
+		auto start = std::chrono::steady_clock::now();
+		stats = SearchStats();
+		stats.agent = name();
+		stats.ply = state.get_depth();
+		stats.empties = state.empty_count();
+		auto action = think(state);
+		stats.move = action.first < 0 ? bitboard::PASS : bitboard::to_pos(action.first, action.second);
+		stats.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (stats.wall_ms > 0)stats.nodes_per_sec = stats.nodes / (stats.wall_ms / 1000);
+		stats.peak_memory_bytes = std::max(stats.peak_memory_bytes, stats.memory_bytes);
+		stats.committed_memory_bytes = std::max(stats.committed_memory_bytes, stats.memory_bytes);
+		return action;
+	}
+
+	virtual const char* name() const = 0;
+
+	// ̎Ԓ state ǂ݂ĂBrequest_stop ܂Ŗ߂ȂĂ悢
+	virtual void ponder(SimpleState) {}
+
+	// ʃXbhTł؂Bł؂ꂽ select_action ̌ʂ͎gȂ
+	void request_stop() {
+		stop_flag.store(true, std::memory_order_relaxed);
+	}
+
+	void clear_stop() {
+		stop_flag.store(false, std::memory_order_relaxed);
+	}
+
+	bool stop_requested() const {
+		return stop_flag.load(std::memory_order_relaxed);
+	}
+
+	void set_limits(const SearchLimits& limits) {
+		this->limits = limits;
+	}
+
+	const SearchLimits& get_limits() const {
+		return this->limits;
+	}
+
+	// 󂫂 wld_empties ȉŏsAexact_empties ȉŐ΍ǂݐ؂B0 ŎgȂ
+	void set_endgame_empties(int wld_empties, int exact_empties) {
+		this->endgame_wld_empties = wld_empties;
+		this->endgame_exact_empties = exact_empties;
+	}
+
+	// O select_action ł̊Sǂ݂̌ʁBǂ܂ȂƂ nodes  0
+	const SolveResult& get_last_solve() const {
+		return this->last_solve;
+	}
+
+	// nullptr ŒՂgȂ
+	void set_opening_book(const OpeningBook* book) {
+		this->book = book;
+	}
+
+	// O select_action ̋L^BTɕʃXbhǂ܂Ȃ
+	const SearchStats& get_last_stats() const {
+		return this->stats;
+	}
 };
 
 class RandomAgent :public Agent {
-public:
-	RandomAgent() {}
-	std::pair<int, int> select_action(SimpleState state) {
+protected:
+	std::pair<int, int> think(SimpleState state) {
 		auto legal_actions = state.legal_actions();
 		int n = legal_actions.size();
 		if (n >= 2) {
@@ -22,6 +147,7 @@ public:
 			n--;
 		}
 		else if (n == 1) {
+			stats.source = SearchStats::Source::Forced;
 			return legal_actions[0];
 		}
 		std::uniform_int_distribution<> rand(0, n - 1);
@@ -29,25 +155,124 @@ public:
 		assert(0 <= idx && idx < legal_actions.size());
 		return legal_actions[idx];
 	}
+
+public:
+	RandomAgent() {}
+
+	const char* name() const {
+		return "random";
+	}
 };
 
 class MonteCalroAgent :public Agent {
-	RandomAgent random_agent;
+	ThreadPool pool;
+	std::vector<PlayoutEngine> playout_engines;
 public:
-	MonteCalroAgent() {}
-	std::pair<int, int> select_action(SimpleState state) {
+	// thread_count  0 Ȃn[hEFAXbh
+	MonteCalroAgent(int thread_count = MONTECALRO_THREAD_COUNT)
+		:pool(thread_count > 0 ? thread_count : (int)std::thread::hardware_concurrency()) {
+		limits.iterations = MONTECALRO_SEARCH_COUNT;
+		set_seed(((uint64_t)rnd() << 32) | rnd());
+	}
+
+	// [J[Ƃ̗͓V[h jump ̂ŁA݂ɏdȂȂ
+	void set_seed(uint64_t seed) {
+		playout_engines.clear();
+		Xoshiro256 rng(seed);
+		for (int i = 0; i < pool.size(); i++) {
+			playout_engines.emplace_back(rng);
+			rng.jump();
+		}
+	}
+
+	int get_thread_count() const {
+		return pool.size();
+	}
+
+	// ܂łɑłvCAEg̑
+	uint64_t get_playout_count() const {
+		uint64_t count = 0;
+		for (auto& engine : playout_engines)count += engine.get_playout_count();
+		return count;
+	}
+
+private:
+	// e round 񂸂vCAEgB(, vCAEg̉)  1 ^XNɂāAʂ̓^XNƂ̗ɏĂWv
+	void run_round(const SimpleState& state, const std::vector<std::pair<int, int>>& legal_actions, int round, std::vector<int>& values) {
+		const int chunks = (round + MONTECALRO_PLAYOUT_CHUNK - 1) / MONTECALRO_PLAYOUT_CHUNK;
+		std::vector<int> task_values(legal_actions.size() * chunks);
+		pool.parallel_for((int)task_values.size(), [&](int task, int worker) {
+			if (stop_requested())return;
+			SimpleState next_state = state.next(legal_actions[task / chunks]);
+			int begin = task % chunks * MONTECALRO_PLAYOUT_CHUNK;
+			int end = std::min(begin + MONTECALRO_PLAYOUT_CHUNK, round);
+			int value = 0;
+			for (int _ = begin; _ < end; _++) {
+				value += -playout_engines[worker].run(next_state);
+			}
+			task_values[task] = value;
+		});
+		for (int task = 0; task < (int)task_values.size(); task++) {
+			values[task / chunks] += task_values[task];
+		}
+	}
+
+	// 1 ̃vCAEgō͍X 2 k܂Ȃ̂ŁAc񐔂 1 ʂւȂΑł؂
+	static bool is_decided(const std::vector<int>& values, double left) {
+		int first = INT_MIN, second = INT_MIN;
+		for (int value : values) {
+			if (value > first) {
+				second = first;
+				first = value;
+			}
+			else if (value > second) {
+				second = value;
+			}
+		}
+		return (double)first - second > 2 * left;
+	}
+
+protected:
+	// limits.iterations  1 肠̃vCAEg
+	std::pair<int, int> think(SimpleState state) {
+		int book_move;
+		if (probe_book(state, book_move))return bitboard::to_action(book_move);
+		SearchClock clock = start_clock(state);
 		auto legal_actions = state.legal_actions();
 
 		// pXȊOłȂpXO
 		if (legal_actions.size() > 1)legal_actions.pop_back();
+		if (legal_actions.size() == 1) {
+			stats.source = SearchStats::Source::Forced;
+			return legal_actions[0];
+		}
+		uint64_t playouts_before = get_playout_count();
 
+		// ԐȂȂ 1 EhőSłBȂ珬ɂāAEhƂɎv
+		const int per_action = limits.iterations > 0 ? limits.iterations : (clock.timed() ? INT_MAX : MONTECALRO_SEARCH_COUNT);
+		const int chunks_per_round = std::max(1, (2 * pool.size() + (int)legal_actions.size() - 1) / (int)legal_actions.size());
 		auto values = std::vector<int>(legal_actions.size());
-		for (int i = 0; i < legal_actions.size(); i++) {
-			for (int _ = 0; _ < MONTECALRO_SEARCH_COUNT; _++) {
-				values[i] += -playout(state.next(legal_actions[i]));
-			}
+		int done = 0;
+		while (done < per_action) {
+			int round = clock.timed() ? MONTECALRO_PLAYOUT_CHUNK * chunks_per_round : per_action;
+			round = std::min(round, per_action - done);
+			run_round(state, legal_actions, round, values);
+			done += round;
+			if (stop_requested() || clock.past_deadline())break;
+			if (clock.timed() && is_decided(values, std::min<double>(per_action - done, clock.estimate_remaining(done))))break;
 		}
-		int val_max = -10000;
+		finish_clock(clock);
+
+		// ؂͖̂ŁA1 ̃vCAEg̎q 1 ̐[ƂĐ
+		stats.iterations = done;
+		stats.playouts = stats.nodes = get_playout_count() - playouts_before;
+		stats.max_depth = 1;
+		stats.average_depth = 1;
+		for (int i = 0; i < (int)legal_actions.size(); i++) {
+			stats.add_root(bitboard::to_pos(legal_actions[i].first, legal_actions[i].second), done, (float)values[i] / std::max(1, done));
+		}
+
+		int val_max = INT_MIN;
 		std::vector<std::pair<int, int>> cood;
 		for (int i = 0; i < legal_actions.size(); i++) {
 			if (values[i] > val_max) {
@@ -64,124 +289,1099 @@ public:
 		return cood[rand(mt)];
 	}
 
-	int playout(SimpleState state) {
-		if (state.is_lose()) {
-			return -1;
-		}
-		if (state.is_draw()) {
-			return 0;
-		}
-		return -playout(state.next(random_agent.select_action(state)));
+public:
+	const char* name() const {
+		return "mc";
+	}
+
+	int playout(const SimpleState& state) {
+		return playout_engines[0].run(state);
 	}
 };
 
+enum class ParallelMode {
+	Tree, // SXbh 1 ̖؂L
+	Root, // XbhƂɕʂ̖؂āA̖K񐔂Z
+};
+
 class MonteCalroTreeAgent :public Agent {
-	RandomAgent random_agent;
-public:
-	int playout(SimpleState state) {
-		if (state.is_lose()) {
-			return -1;
-		}
-		if (state.is_draw()) {
-			return 0;
-		}
-		return -playout(state.next(random_agent.select_action(state)));
-	}
-	MonteCalroTreeAgent() {}
-	class Node {
-		SimpleState state;
-		int w, n;
-		std::vector<Node> child_nodes;
-	public:
-		Node(SimpleState state) :state(state), w(0), n(0) {}
-		int evaluate(MonteCalroTreeAgent& agent) {
-			if (this->state.is_done()) {
-				int value = this->state.is_lose() ? -1 : 0;
-				this->w += value;
-				this->n++;
-				return value;
-			}
-
-			if (this->child_nodes.empty()) {
-				int value = agent.playout(this->state);
-				this->w += value;
-				this->n++;
-				if (this->n == MCTS_EXPAND_LIMIT) {
-					expand();
+	// t܂ł̓؁B]ςނ܂œ؏̃m[hɉzsktĂ
+	struct Leaf {
+		uint32_t path[128]; // Ֆʂ܂܂ł̎萔 + pX̕
+		int length;
+		bool expand;
+		int state_index; // LeafBatch::states ł̈ʒuBIǂȂ -1
+		int value;
+	};
+
+	// XbhƂ̍Ɨ̈BTɊmۂȂ悤ɍŏɗpӂĂ
+	struct LeafBatch {
+		std::vector<Leaf> leaves;
+		std::vector<SimpleState> states;
+		std::vector<int> values;
+		std::vector<uint64_t> played; // tƂ 2 BLeafEvaluator::evaluate  played
+	};
+
+	// ؂~Ƃ̎q̑Iѕ
+	struct TreePolicy {
+		bool rave = false;     // qł̌ʂɉāAł̎łŤ (AMAF) 
+		bool widening = false; // q evaluator::MOVE_ORDER ̏ɕׁAe̖K񐔂ɉđIׂq擪瑝₷
+	};
+
+	std::vector<PlayoutEngine> playout_engines;
+	std::vector<LeafBatch> leaf_batches;
+	std::shared_ptr<const LeafEvaluator> leaf_evaluator;
+	int batch_size;
+	TreePolicy policy;
+	NodeArena arena;
+	NodeArena spare_arena;
+	TranspositionTable table;
+	std::vector<std::unique_ptr<NodeArena>> worker_arenas;
+	uint32_t root;
+	bool has_tree;
+	SimpleState root_state;
+	int reused_visits;
+	const PatternEvaluator* cutoff_evaluator;
+	int cutoff_plies;
+	int thread_count;
+	ParallelMode parallel_mode;
+	uint32_t node_limit;
+	double prune_keep;
+	uint64_t prune_count;
+	uint64_t pruned_nodes;
+	size_t peak_memory; // ̒Tł tree_memory ̍ő
+
+	// ~肽[̏WvBXbhƂɐāAT̏Iɂ܂Ƃ߂
+	struct DepthCount {
+		uint64_t sum = 0;
+		uint64_t count = 0;
+		int max = 0;
+
+		void add(int depth) {
+			sum += depth;
+			count++;
+			max = std::max(max, depth);
+		}
+
+		void merge(const DepthCount& other) {
+			sum += other.sum;
+			count += other.count;
+			max = std::max(max, other.max);
+		}
+	};
+
+	struct SearchControl {
+		std::atomic<int> remaining;
+		std::atomic<bool> finished;
+		std::atomic<bool> tree_full; // 荞ނ߂ɑSXbh~߂
+		bool prune;                  // ؂tɂȂ犠荞ށBfalse ȂWJ߂ĒT𑱂
+		int iterations;
+		const SearchClock& clock;
+		TranspositionTable* table; // gȂ nullptr
+		std::mutex mutex;
+		DepthCount depth;
+
+		SearchControl(int iterations, const SearchClock& clock, TranspositionTable* table, bool prune)
+			:remaining(iterations), finished(false), tree_full(false), prune(prune), iterations(iterations), clock(clock), table(table) {}
+	};
+
+	// ŏ EXPANDING XbhWJBA[itȂ EXPANDING ̂܂ܗtƂĈ
+	// ordered Ȃq evaluator::MOVE_ORDER ̏ɁAłȂ΃}X̔ԍɕׂ
+	static void expand(NodeArena& tree, uint32_t index, const SimpleState& state, bool ordered) {
+		uint8_t expected = TreeNode::LEAF;
+		if (!tree[index].expand_state.compare_exchange_strong(expected, TreeNode::EXPANDING))return;
+		uint64_t moves = state.legal_moves();
+		int count = moves ? bitboard::popcount(moves) : 1;
+		uint32_t first = tree.allocate(count);
+		if (first == NodeArena::INVALID)return;
+		int i = 0;
+		auto add_child = [&](int move) {
+			TreeNode& child = tree[first + i++];
+			child = TreeNode();
+			child.move = (uint8_t)move;
+			child.hash = state.hash_after(move);
+		};
+		if (!moves) {
+			add_child(bitboard::PASS);
+		}
+		else if (ordered) {
+			for (uint64_t mask : evaluator::MOVE_ORDER) {
+				for (uint64_t b = moves & mask; b; b &= b - 1)add_child(bitboard::lsb(b));
+			}
+		}
+		else {
+			for (uint64_t b = moves; b; b &= b - 1)add_child(bitboard::lsb(b));
+		}
+		tree[index].first_child = first;
+		tree[index].child_count = (uint8_t)count;
+		tree[index].expand_state.store(TreeNode::EXPANDED, std::memory_order_release);
+	}
+
+	// QiIWJŁAq̖K񐔂̍v t ̂ƂɑIׂq̐
+	static int widened_count(int child_count, int t) {
+		int count = MCTS_WIDENING_BASE;
+		for (int visits = MCTS_WIDENING_VISITS; t >= visits && count < child_count; visits *= 2)count++;
+		return std::min(count, child_count);
+	}
+
+	// u\ɕʂ̎菇痈܂߂Ă葽̖K₪΁Ȁg
+	// RAVE ł͖K̏Ȃqق AMAF ̏Ɋ񂹁A܂K̂Ȃq AMAF ̏Ŕׂ
+	static uint32_t next_child_node(const NodeArena& tree, uint32_t index, const TranspositionTable* table, const TreePolicy& policy) {
+		const TreeNode& node = tree[index];
+		uint32_t first = node.first_child, last = first + node.child_count;
+		int t = 0;
+		for (uint32_t i = first; i < last; i++) {
+			t += tree[i].n.load(std::memory_order_relaxed);
+		}
+		if (policy.widening)last = first + widened_count(node.child_count, t);
+		if (!policy.rave) {
+			for (uint32_t i = first; i < last; i++) {
+				if (tree[i].n.load(std::memory_order_relaxed) == 0)return i;
+			}
+		}
+		double log_t = log(std::max(t, 1));
+		double c2 = policy.rave ? MCTS_RAVE_EXPLORATION * MCTS_RAVE_EXPLORATION : 2;
+		uint32_t idx = first;
+		double val_max = -10000;
+		for (uint32_t i = first; i < last; i++) {
+			int w = tree[i].w.load(std::memory_order_relaxed);
+			int n = tree[i].n.load(std::memory_order_relaxed);
+			double value = n > 0 ? -w / (double)n : 1;
+			if (table) {
+				if (const TTEntry* entry = table->find(tree[i].hash)) {
+					int table_n = entry->n.load(std::memory_order_relaxed);
+					if (table_n > n)value = -entry->w.load(std::memory_order_relaxed) / (double)table_n;
+				}
+			}
+			if (policy.rave) {
+				int amaf_n = tree[i].amaf_n.load(std::memory_order_relaxed);
+				if (amaf_n > 0) {
+					double beta = sqrt(MCTS_RAVE_EQUIVALENCE / (3.0 * n + MCTS_RAVE_EQUIVALENCE));
+					value = beta * (-tree[i].amaf_w.load(std::memory_order_relaxed) / (double)amaf_n) + (1 - beta) * value;
 				}
-				return value;
+			}
+			double ucb1_value = value + sqrt(c2 * log_t / (double)std::max(n, 1));
+			if (ucb1_value > val_max) {
+				idx = i;
+				val_max = ucb1_value;
+			}
+		}
+		return idx;
+	}
+
+	// t܂ō~BI񂾎qɂ͉zsk (肩猩) 𑫂āÃXbh⓯̗̎tʂ̎}֌킹
+	// Iǂɒ leaf.value Ɍʂ false ԂBłȂ state t̋ǖʂɂȂ
+	static bool select_leaf(NodeArena& tree, uint32_t root, SimpleState& state, TranspositionTable* table, const TreePolicy& policy, Leaf& leaf) {
+		leaf.length = 0;
+		leaf.expand = false;
+		uint32_t index = root;
+		while (true) {
+			leaf.path[leaf.length++] = index;
+			TreeNode& node = tree[index];
+			if (state.is_done()) {
+				int diff = state.disc_difference();
+				leaf.value = (diff > 0) - (diff < 0);
+				return false;
+			}
+			if (!node.is_expanded()) {
+				leaf.expand = node.n.load(std::memory_order_relaxed) + 1 >= MCTS_EXPAND_LIMIT;
+				return true;
+			}
+			index = next_child_node(tree, index, table, policy);
+			tree[index].w.fetch_add(MCTS_VIRTUAL_LOSS, std::memory_order_relaxed);
+			tree[index].n.fetch_add(MCTS_VIRTUAL_LOSS, std::memory_order_relaxed);
+			state.make_move(tree[index].move);
+		}
+	}
+
+	// em[h w ́Ãm[h̎ԑ猩l
+	static void backup(NodeArena& tree, const Leaf& leaf, TranspositionTable* table) {
+		int value = leaf.value;
+		for (int i = leaf.length - 1; i >= 0; i--) {
+			int virtual_loss = i > 0 ? MCTS_VIRTUAL_LOSS : 0;
+			tree[leaf.path[i]].w.fetch_add(value - virtual_loss, std::memory_order_relaxed);
+			tree[leaf.path[i]].n.fetch_add(1 - virtual_loss, std::memory_order_relaxed);
+			if (table)table->update(tree[leaf.path[i]].hash, value);
+			value = -value;
+		}
+	}
+
+	// t獪֖߂ȂAem[h̎ԑ̃m[hȍ~ (؂̒ƃvCAEg) ɑł}XW߁A̎̎q AMAF Ɍʂ𑫂
+	// played ͗t̎ԑƑ肪vCAEgőł}X
+	static void update_amaf(NodeArena& tree, const Leaf& leaf, const uint64_t* played) {
+		uint64_t seen[2] = { played[0], played[1] }; // [0] t̎ԑ
+		for (int i = leaf.length - 1; i >= 0; i--) {
+			int side = (leaf.length - 1 - i) % 2;
+			if (i + 1 < leaf.length) {
+				int move = tree[leaf.path[i + 1]].move;
+				if (move != bitboard::PASS)seen[side] |= bitboard::bit(move);
+			}
+			const TreeNode& node = tree[leaf.path[i]];
+			if (!node.is_expanded())continue;
+			// q w ͎q̎ԑA܂ node ̑肩猩l
+			int value = side == 0 ? -leaf.value : leaf.value;
+			for (uint32_t c = node.first_child; c < node.first_child + node.child_count; c++) {
+				int move = tree[c].move;
+				if (move == bitboard::PASS || !(seen[side] & bitboard::bit(move)))continue;
+				tree[c].amaf_w.fetch_add(value, std::memory_order_relaxed);
+				tree[c].amaf_n.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// t count W߁A܂Ƃ߂ĕ]Ă܂Ƃ߂Ė߂
+	void evaluate_batch(NodeArena& tree, uint32_t root, const SimpleState& root_state, LeafBatch& batch, int count, PlayoutEngine& engine, TranspositionTable* table, DepthCount& depth) const {
+		int pending = 0;
+		for (int i = 0; i < count; i++) {
+			Leaf& leaf = batch.leaves[i];
+			SimpleState& state = batch.states[pending];
+			state = root_state;
+			leaf.state_index = select_leaf(tree, root, state, table, policy, leaf) ? pending++ : -1;
+			depth.add(leaf.length - 1);
+		}
+		leaf_evaluator->evaluate(batch.states.data(), pending, batch.values.data(), engine, policy.rave ? batch.played.data() : nullptr);
+		for (int i = 0; i < count; i++) {
+			Leaf& leaf = batch.leaves[i];
+			if (leaf.state_index >= 0)leaf.value = batch.values[leaf.state_index];
+			backup(tree, leaf, table);
+			if (policy.rave) {
+				static const uint64_t NONE[2] = {};
+				update_amaf(tree, leaf, leaf.state_index >= 0 ? &batch.played[2 * leaf.state_index] : NONE);
+			}
+		}
+		for (int i = 0; i < count; i++) {
+			const Leaf& leaf = batch.leaves[i];
+			if (leaf.expand)expand(tree, leaf.path[leaf.length - 1], batch.states[leaf.state_index], policy.widening);
+		}
+	}
+
+	// ߐ؂߂Ac̉񐔂S 2 ʂɉ񂵂Ă 1 ʂ̖K񐔂ɓ͂ȂΏI
+	bool should_finish(const SearchControl& control) const {
+		if (control.clock.past_deadline())return true;
+		if (thread_count > 1 && parallel_mode == ParallelMode::Root)return false;
+		int remaining = std::max(0, control.remaining.load(std::memory_order_relaxed));
+		double left = std::min<double>(remaining, control.clock.estimate_remaining(control.iterations - remaining));
+		const TreeNode& root_node = arena[root];
+		int first = 0, second = 0;
+		for (uint32_t i = root_node.first_child; i < root_node.first_child + root_node.child_count; i++) {
+			int n = arena[i].n.load(std::memory_order_relaxed);
+			if (n > first) {
+				second = first;
+				first = n;
+			}
+			else if (n > second) {
+				second = n;
+			}
+		}
+		return first - second > left;
+	}
+
+	void run_worker(NodeArena& tree, uint32_t root, const SimpleState& state, int thread, SearchControl& control) {
+		int count = 0, next_check = MCTS_TIME_CHECK_INTERVAL;
+		DepthCount depth;
+		while (!stop_requested() && !control.finished.load(std::memory_order_relaxed) && !control.tree_full.load(std::memory_order_relaxed)) {
+			int remaining = control.remaining.fetch_sub(batch_size, std::memory_order_relaxed);
+			if (remaining <= 0)break;
+			int size = std::min(batch_size, remaining);
+			evaluate_batch(tree, root, state, leaf_batches[thread], size, playout_engines[thread], control.table, depth);
+			if (control.prune && tree.full())control.tree_full.store(true, std::memory_order_relaxed);
+			if ((count += size) >= next_check) {
+				next_check = count + MCTS_TIME_CHECK_INTERVAL;
+				if (should_finish(control))control.finished.store(true, std::memory_order_relaxed);
+			}
+		}
+		std::lock_guard<std::mutex> lock(control.mutex);
+		control.depth.merge(depth);
+	}
+
+	// O̍ 2 ȓ (̎ + ̉)  state Ɉvm[hT
+	uint32_t find_node(const SimpleState& state) const {
+		const TreeNode& root_node = arena[root];
+		if (!root_node.is_expanded())return NodeArena::INVALID;
+		for (uint32_t i = root_node.first_child; i < root_node.first_child + root_node.child_count; i++) {
+			SimpleState child_state = root_state.next(arena[i].move);
+			if (child_state == state)return i;
+			if (!arena[i].is_expanded())continue;
+			for (uint32_t j = arena[i].first_child; j < arena[i].first_child + arena[i].child_count; j++) {
+				if (child_state.next(arena[j].move) == state)return j;
+			}
+		}
+		return NodeArena::INVALID;
+	}
+
+	// v镔؂΍ɏiAĉ͎Ă
+	void set_root(const SimpleState& state) {
+		uint32_t index = NodeArena::INVALID;
+		if (has_tree) {
+			index = (root_state == state) ? root : find_node(state);
+		}
+		if (index != NodeArena::INVALID) {
+			spare_arena.copy_subtree(arena, index);
+			arena.swap(spare_arena);
+			spare_arena.reset();
+		}
+		else {
+			arena.reset();
+			arena.allocate(1);
+			arena[0] = TreeNode();
+		}
+		this->root = 0;
+		this->root_state = state;
+		this->has_tree = true;
+		this->reused_visits = arena[root].n;
+		expand(arena, root, state, policy.widening);
+		if (!arena[root].is_expanded()) {
+			arena.reset();
+			arena.allocate(1);
+			arena[0] = TreeNode();
+			this->reused_visits = 0;
+			expand(arena, root, state, policy.widening);
+		}
+		arena[root].hash = state.get_hash();
+		table.new_search();
+	}
+
+	void search_tree_parallel(const SimpleState& state, SearchControl& control) {
+		std::vector<std::thread> workers;
+		for (int t = 1; t < thread_count; t++) {
+			workers.emplace_back([&, t]() {
+				run_worker(arena, root, state, t, control);
+			});
+		}
+		run_worker(arena, root, state, 0, control);
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	void search_root_parallel(const SimpleState& state, SearchControl& control, std::array<int, bitboard::PASS + 1>& visits) {
+		std::vector<std::thread> workers;
+		for (int t = 1; t < thread_count; t++) {
+			NodeArena& tree = *worker_arenas[t - 1];
+			tree.reset();
+			tree.allocate(1);
+			tree[0] = TreeNode();
+			tree[0].hash = state.get_hash();
+			expand(tree, 0, state, policy.widening);
+			workers.emplace_back([&, t]() {
+				run_worker(tree, 0, state, t, control);
+			});
+		}
+		run_worker(arena, root, state, 0, control);
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		for (auto& tree : worker_arenas) {
+			const TreeNode& tree_root = (*tree)[0];
+			for (uint32_t i = tree_root.first_child; i < tree_root.first_child + tree_root.child_count; i++) {
+				visits[(*tree)[i].move] += (*tree)[i].n;
+			}
+		}
+	}
+
+	// K̏Ȃ؂؂A prune_keep ̊Ɏ܂悤ɋlߒB؂؂̖K͐e w, n ɎcĂ
+	// SXbh~܂ĂĉzskcĂȂƂɌĂ
+	void prune_tree() {
+		uint32_t before = arena.size();
+		peak_memory = std::max(peak_memory, tree_memory());
+		int min_visits = arena.min_visits_to_fit(root, (uint32_t)(arena.capacity() * prune_keep));
+		spare_arena.copy_subtree(arena, root, min_visits);
+		arena.swap(spare_arena);
+		spare_arena.reset();
+		this->root = 0;
+		this->prune_count++;
+		this->pruned_nodes += before - arena.size();
+	}
+
+	// Root [hł͑Xbh̖؂̖̍K񐔂 visits ɑB~肽[̏WvԂ
+	// ؂tɂȂ犠荞őBRoot [h̖؂̓XbhƂɂ̂Ŋ荞܂AtɂȂWJ߂
+	DepthCount search(const SimpleState& state, int iterations, const SearchClock& clock, std::array<int, bitboard::PASS + 1>& visits) {
+		bool prune = prune_keep > 0 && (thread_count == 1 || parallel_mode == ParallelMode::Tree);
+		SearchControl control(iterations, clock, table.enabled() ? &table : nullptr, prune);
+		while (true) {
+			if (thread_count == 1) {
+				run_worker(arena, root, state, 0, control);
+			}
+			else if (parallel_mode == ParallelMode::Tree) {
+				search_tree_parallel(state, control);
 			}
 			else {
-				Node& next_node = next_child_node();
-				int value = -next_node.evaluate(agent);
-				this->w += value;
-				this->n++;
-				return value;
+				search_root_parallel(state, control, visits);
 			}
+			if (!control.tree_full.load(std::memory_order_relaxed))break;
+			if (stop_requested() || control.finished.load(std::memory_order_relaxed) || control.remaining.load(std::memory_order_relaxed) <= 0)break;
+			prune_tree();
+			control.tree_full.store(false, std::memory_order_relaxed);
 		}
+		return control.depth;
+	}
+
+	// 2 ̃A[iAu\ARoot [h̃XbhƂ̖؂ŎۂɃgĂ
+	size_t committed_memory() const {
+		size_t bytes = arena.memory_usage() + spare_arena.memory_usage() + table.memory_usage();
+		for (auto& tree : worker_arenas)bytes += tree->memory_usage();
+		return bytes;
+	}
+
+	size_t tree_memory() const {
+		size_t bytes = (size_t)arena.size() * sizeof(TreeNode);
+		for (auto& tree : worker_arenas)bytes += (size_t)tree->size() * sizeof(TreeNode);
+		return bytes;
+	}
 
-		void expand() {
-			auto legal_actions = state.legal_actions();
-			for (auto action : legal_actions) {
-				this->child_nodes.push_back(Node(this->state.next(action)));
+public:
+	int playout(const SimpleState& state) {
+		return playout_engines[0].run(state);
+	}
+
+	// thread_count  0 Ȃn[hEFAXbh
+	MonteCalroTreeAgent(int thread_count = MCTS_THREAD_COUNT, ParallelMode parallel_mode = ParallelMode::Tree)
+		:leaf_evaluator(std::make_shared<PlayoutLeafEvaluator>()), batch_size(MCTS_BATCH_SIZE),
+		arena(MCTS_NODE_LIMIT), spare_arena(MCTS_NODE_LIMIT), table(MCTS_TT_SIZE_MB), root(0), has_tree(false), reused_visits(0),
+		cutoff_evaluator(PatternEvaluator::shared()), cutoff_plies(MCTS_PLAYOUT_CUTOFF), thread_count(1), parallel_mode(parallel_mode),
+		node_limit(MCTS_NODE_LIMIT), prune_keep(MCTS_PRUNE_KEEP), prune_count(0), pruned_nodes(0), peak_memory(0) {
+		limits.iterations = MONTECALRO_TREE_SEARCH_COUNT;
+		set_endgame_empties(ENDGAME_WLD_EMPTIES, ENDGAME_EXACT_EMPTIES);
+		set_thread_count(thread_count);
+	}
+
+	void set_thread_count(int thread_count) {
+		if (thread_count <= 0) {
+			thread_count = std::max(1, (int)std::thread::hardware_concurrency());
+		}
+		this->thread_count = thread_count;
+		while ((int)playout_engines.size() < thread_count) {
+			playout_engines.emplace_back(((uint64_t)rnd() << 32) | rnd());
+			playout_engines.back().set_cutoff(cutoff_evaluator, cutoff_plies);
+		}
+		set_batch_size(this->batch_size);
+		worker_arenas.clear();
+		if (parallel_mode == ParallelMode::Root) {
+			for (int t = 1; t < thread_count; t++) {
+				worker_arenas.push_back(std::make_unique<NodeArena>(node_limit / thread_count));
 			}
 		}
+	}
+
+	// vCAEg plies őł؂Aevaluator ̕]l̕ʂɂBplies  0 ȂIǂ܂őł
+	void set_playout_cutoff(const PatternEvaluator* evaluator, int plies) {
+		this->cutoff_evaluator = evaluator;
+		this->cutoff_plies = plies;
+		for (auto& engine : playout_engines)engine.set_cutoff(evaluator, plies);
+	}
+
+	// 1 XbhxɏW߂ĕ]t̐
+	void set_batch_size(int batch_size) {
+		this->batch_size = std::clamp(batch_size, 1, MCTS_MAX_BATCH_SIZE);
+		leaf_batches.resize(thread_count);
+		for (auto& batch : leaf_batches) {
+			batch.leaves.resize(this->batch_size);
+			batch.states.resize(this->batch_size);
+			batch.values.resize(this->batch_size);
+			batch.played.resize(2 * this->batch_size);
+		}
+	}
+
+	int get_batch_size() const {
+		return this->batch_size;
+	}
+
+	// t̕]@ւB̓vCAEg
+	void set_leaf_evaluator(std::shared_ptr<const LeafEvaluator> evaluator) {
+		this->leaf_evaluator = std::move(evaluator);
+	}
+
+	void set_parallel_mode(ParallelMode parallel_mode) {
+		this->parallel_mode = parallel_mode;
+		set_thread_count(this->thread_count);
+	}
+
+	int get_thread_count() const {
+		return this->thread_count;
+	}
+
+	// q̑Iѕ RAVE 
+	void set_rave(bool rave) {
+		this->policy.rave = rave;
+	}
+
+	// QiIWJBɓWJqяς
+	void set_progressive_widening(bool widening) {
+		this->policy.widening = widening;
+	}
+
+	// ؂̃m[h̏Blߒp̗̈ƍ킹 2 { TreeNode mۂB̖؂͎̂Ă
+	void set_node_limit(uint32_t node_limit) {
+		this->node_limit = std::max<uint32_t>(node_limit, bitboard::PASS + 1);
+		arena.set_capacity(this->node_limit);
+		spare_arena.set_capacity(this->node_limit);
+		this->has_tree = false;
+		set_thread_count(this->thread_count);
+	}
+
+	uint32_t get_node_limit() const {
+		return this->node_limit;
+	}
+
+	// ؂tɂȂƂÂ̊܂Ŋ荞ŒT𑱂B0 Ȃ犠荞܂ɓWJ߂
+	void set_prune_keep(double keep) {
+		this->prune_keep = std::clamp(keep, 0.0, 1.0);
+	}
+
+	// ܂łɊ荞񂾉񐔂ƁAŎ̂Ăm[h
+	uint64_t get_prune_count() const {
+		return this->prune_count;
+	}
+
+	uint64_t get_pruned_nodes() const {
+		return this->pruned_nodes;
+	}
+
+	// u\̑傫 (MB)B0 ŎgȂ
+	void set_table_size(size_t size_mb) {
+		table.resize(size_mb);
+	}
+
+	const TranspositionTable& get_table() const {
+		return this->table;
+	}
+
+	// ܂łɑłvCAEg̑B1 ̒T 1 ł̂ŒT񐔂Ɠ
+	uint64_t get_playout_count() const {
+		uint64_t count = 0;
+		for (auto& engine : playout_engines)count += engine.get_playout_count();
+		return count;
+	}
+
+	// O select_action őO̒Tp̖K
+	int get_reused_visits() const {
+		return this->reused_visits;
+	}
+
+	// ~߂܂Ŗ؂ĂB select_action ő̉̕؂ėp
+	void ponder(SimpleState state) {
+		set_root(state);
+		std::array<int, bitboard::PASS + 1> visits{};
+		search(state, INT_MAX, SearchClock(), visits);
+	}
+
+	const char* name() const {
+		return "mcts";
+	}
+
+protected:
+	// limits.iterations  1 肠̖؂̒T
+	std::pair<int, int> think(SimpleState state) {
+		int book_move;
+		if (probe_book(state, book_move))return bitboard::to_action(book_move);
+		SearchClock clock = start_clock(state);
+		if (solve_endgame(state, clock)) {
+			finish_clock(clock);
+			return bitboard::to_action(last_solve.move);
+		}
+		uint64_t playouts_before = get_playout_count();
+		uint64_t prunes_before = prune_count;
+		this->peak_memory = 0;
+		set_root(state);
+		std::array<int, bitboard::PASS + 1> visits{};
+		// 1 肵ȂΒTȂ
+		if (arena[root].child_count > 1) {
+			int iterations = limits.iterations > 0 ? limits.iterations : (clock.timed() ? INT_MAX : MONTECALRO_TREE_SEARCH_COUNT);
+			DepthCount depth = search(state, iterations, clock, visits);
+			stats.iterations = depth.count;
+			stats.nodes = depth.sum;
+			stats.max_depth = depth.max;
+			stats.average_depth = depth.count ? (double)depth.sum / depth.count : 0;
+		}
+		else {
+			stats.source = SearchStats::Source::Forced;
+		}
+		finish_clock(clock);
+		stats.playouts = get_playout_count() - playouts_before;
+		stats.memory_bytes = tree_memory();
+		stats.peak_memory_bytes = peak_memory;
+		stats.committed_memory_bytes = committed_memory();
+		stats.prunes = (int)(prune_count - prunes_before);
 
-		Node& next_child_node() {
-			for (auto& child_node : this->child_nodes) {
-				if (child_node.n == 0)return child_node;
+		const TreeNode& root_node = arena[root];
+		for (uint32_t i = root_node.first_child; i < root_node.first_child + root_node.child_count; i++) {
+			visits[arena[i].move] += arena[i].n;
+			int n = arena[i].n;
+			stats.add_root(arena[i].move, visits[arena[i].move], n > 0 ? -arena[i].w / (float)n : 0);
+		}
+		int n_max = -10000;
+		int move = bitboard::PASS;
+		for (uint32_t i = root_node.first_child; i < root_node.first_child + root_node.child_count; i++) {
+			if (visits[arena[i].move] > n_max) {
+				move = arena[i].move;
+				n_max = visits[arena[i].move];
 			}
-			int t = 0;
-			for (auto child_node : this->child_nodes) {
-				t += child_node.n;
+		}
+		return bitboard::to_action(move);
+	}
+};
+
+// [ alpha-betaB]̓p^[]΂AȂ evaluator::evaluate gAO̐[̒l𒆐Sɂǂݎn߂
+//  u\̎ > L[ > qXg[̑ ̏ɓǂ
+class AlphaBetaAgent :public Agent {
+	static const int INF = 1 << 20;
+	static const int WIN = 1 << 16; // Iǂ̒lB]l͂\
+	static const int MAX_PLY = 128;
+
+	enum : uint8_t { EXACT, LOWER, UPPER };
+
+	struct HashEntry {
+		uint64_t player;
+		uint64_t opponent;
+		int32_t score;
+		int8_t depth;
+		uint8_t bound;
+		uint8_t move;
+	};
+
+	struct Move {
+		uint64_t bit;
+		uint64_t flips;
+		int key;
+	};
+
+	struct RootMove {
+		int pos;
+		uint64_t flips;
+		int score;
+	};
+
+	std::vector<HashEntry> table;
+	uint8_t killers[MAX_PLY][2];
+	int history[bitboard::CELLS];
+	uint64_t nodes;
+	int max_ply; // IIɐ[ǂ񂾕܂߂ő̐[
+	uint64_t next_check;
+	bool aborted;
+	const SearchClock* clock;
+	int last_depth;
+	int last_score;
+	const PatternEvaluator* patterns;
+
+	// d݃t@C̒l傫ĂIǂ̒lƍȂ悤Ɋۂ߂
+	int evaluate(uint64_t p, uint64_t o) const {
+		if (!patterns)return evaluator::evaluate(p, o);
+		return std::clamp(patterns->evaluate(p, o), -WIN + 1, WIN - 1);
+	}
+
+	static int final_score(uint64_t p, uint64_t o) {
+		int diff = bitboard::popcount(p) - bitboard::popcount(o);
+		return diff > 0 ? WIN + diff : (diff < 0 ? -WIN + diff : 0);
+	}
+
+	HashEntry& hash_entry(uint64_t p, uint64_t o) {
+		uint64_t h = p * 0x9e3779b97f4a7c15ULL ^ o * 0xc2b2ae3d27d4eb4fULL;
+		h ^= h >> 29;
+		return table[h & (table.size() - 1)];
+	}
+
+	// 1 iڂ͎~߂ɓǂݐ؂AKԂ悤ɂ
+	bool check_stop() {
+		if (this->clock && this->nodes >= this->next_check) {
+			this->next_check = this->nodes + 1024;
+			if (stop_requested() || this->clock->past_deadline())this->aborted = true;
+		}
+		return this->aborted;
+	}
+
+	int order_moves(uint64_t p, uint64_t o, uint64_t moves, int hash_move, int ply, Move* list) {
+		int count = 0;
+		for (; moves; moves &= moves - 1) {
+			Move& m = list[count++];
+			m.bit = moves & (0 - moves);
+			m.flips = bitboard::flips(p, o, m.bit);
+			int pos = bitboard::lsb(m.bit);
+			if (pos == hash_move)m.key = 1 << 30;
+			else if (ply < MAX_PLY && pos == killers[ply][0])m.key = 1 << 29;
+			else if (ply < MAX_PLY && pos == killers[ply][1])m.key = 1 << 28;
+			else m.key = history[pos];
+		}
+		std::sort(list, list + count, [](const Move& a, const Move& b) { return a.key > b.key; });
+		return count;
+	}
+
+	void update_cutoff(int pos, int depth, int ply) {
+		history[pos] += depth * depth;
+		if (ply < MAX_PLY && killers[ply][0] != pos) {
+			killers[ply][1] = killers[ply][0];
+			killers[ply][0] = (uint8_t)pos;
+		}
+	}
+
+	int search(uint64_t p, uint64_t o, int depth, int alpha, int beta, int ply, bool passed) {
+		if (check_stop())return 0;
+		this->nodes++;
+		this->max_ply = std::max(this->max_ply, ply);
+		if (depth <= 0)return evaluate(p, o);
+		uint64_t moves = bitboard::legal_moves(p, o);
+		if (!moves) {
+			if (passed)return final_score(p, o);
+			return -search(o, p, depth, -beta, -alpha, ply + 1, true);
+		}
+
+		HashEntry& entry = hash_entry(p, o);
+		int hash_move = bitboard::PASS;
+		if (entry.player == p && entry.opponent == o) {
+			hash_move = entry.move;
+			if (entry.depth >= depth) {
+				if (entry.bound == EXACT)return entry.score;
+				if (entry.bound == LOWER && entry.score >= beta)return entry.score;
+				if (entry.bound == UPPER && entry.score <= alpha)return entry.score;
 			}
-			std::vector<double> ucb1_values;
-			for (auto child_node : this->child_nodes) {
-				ucb1_values.push_back(-child_node.w / (double)child_node.n + sqrt((2 * log(t) / (double)child_node.n)));
+		}
+
+		Move list[bitboard::CELLS];
+		int count = order_moves(p, o, moves, hash_move, ply, list);
+		int original_alpha = alpha;
+		int best = -INF, best_pos = bitboard::lsb(list[0].bit);
+		for (int i = 0; i < count; i++) {
+			uint64_t next_p = o & ~list[i].flips, next_o = p | list[i].bit | list[i].flips;
+			int score;
+			if (i == 0) {
+				score = -search(next_p, next_o, depth - 1, -beta, -alpha, ply + 1, false);
+			}
+			else {
+				score = -search(next_p, next_o, depth - 1, -alpha - 1, -alpha, ply + 1, false);
+				if (alpha < score && score < beta) {
+					score = -search(next_p, next_o, depth - 1, -beta, -score, ply + 1, false);
+				}
 			}
-			int idx = -1;
-			double val_max = -10000;
-			for (int i = 0; i < ucb1_values.size(); i++) {
-				if (ucb1_values[i] > val_max) {
-					idx = i;
-					val_max = ucb1_values[i];
+			if (this->aborted)return 0;
+			if (score > best) {
+				best = score;
+				best_pos = bitboard::lsb(list[i].bit);
+				if (best > alpha) {
+					alpha = best;
+					if (alpha >= beta) {
+						update_cutoff(best_pos, depth, ply);
+						break;
+					}
 				}
 			}
-			return this->child_nodes[idx];
 		}
 
-		int get_n() {
-			return this->n;
+		entry = { p, o, best, (int8_t)depth, (uint8_t)(best <= original_alpha ? UPPER : (best >= beta ? LOWER : EXACT)), (uint8_t)best_pos };
+		return best;
+	}
+
+	// ǂ񂾒l̏ moves בւB̊Oɏoł؂āAǂ܂Ȃ͍Ōɉ
+	int search_root(uint64_t p, uint64_t o, int depth, int alpha, int beta, std::vector<RootMove>& moves) {
+		this->nodes++;
+		int best = -INF;
+		for (size_t i = 0; i < moves.size(); i++) {
+			uint64_t move = bitboard::bit(moves[i].pos);
+			uint64_t next_p = o & ~moves[i].flips, next_o = p | move | moves[i].flips;
+			int score;
+			if (i == 0) {
+				score = -search(next_p, next_o, depth - 1, -beta, -alpha, 1, false);
+			}
+			else {
+				score = -search(next_p, next_o, depth - 1, -alpha - 1, -alpha, 1, false);
+				if (alpha < score && score < beta) {
+					score = -search(next_p, next_o, depth - 1, -beta, -score, 1, false);
+				}
+			}
+			if (this->aborted)return 0;
+			moves[i].score = score;
+			if (score > best) {
+				best = score;
+				alpha = std::max(alpha, score);
+				if (alpha >= beta) {
+					for (size_t j = i + 1; j < moves.size(); j++)moves[j].score = -INF;
+					break;
+				}
+			}
 		}
+		std::stable_sort(moves.begin(), moves.end(), [](const RootMove& a, const RootMove& b) { return a.score > b.score; });
+		return best;
+	}
+
+public:
+	AlphaBetaAgent() :table((size_t)1 << ALPHABETA_HASH_BITS), nodes(0), max_ply(0), next_check(0), aborted(false), clock(nullptr), last_depth(0), last_score(0), patterns(PatternEvaluator::shared()) {
+		limits.iterations = ALPHABETA_DEPTH;
+		set_endgame_empties(ENDGAME_WLD_EMPTIES, ENDGAME_EXACT_EMPTIES);
+	}
+
+	// nullptr ȂrbgZ̕]֐g
+	void set_pattern_evaluator(const PatternEvaluator* patterns) {
+		this->patterns = patterns;
+	}
+
+	uint64_t get_node_count() const {
+		return this->nodes;
+	}
 
-		std::vector<Node> get_child_nodes() {
-			return this->child_nodes;
+	// O select_action œǂݏI[Ƃ̕]l
+	int get_last_depth() const {
+		return this->last_depth;
+	}
+
+	int get_last_score() const {
+		return this->last_score;
+	}
+
+	const char* name() const {
+		return "ab";
+	}
+
+protected:
+	// limits.iterations ͓ǂސ[̏BԐΒߐ؂܂Ő[
+	std::pair<int, int> think(SimpleState state) {
+		this->last_depth = 0;
+		int book_move;
+		if (probe_book(state, book_move))return bitboard::to_action(book_move);
+		SearchClock clock = start_clock(state);
+		if (solve_endgame(state, clock)) {
+			finish_clock(clock);
+			return bitboard::to_action(last_solve.move);
+		}
+		uint64_t p = state.get_player(), o = state.get_opponent();
+		uint64_t legal = state.legal_moves();
+		if (bitboard::popcount(legal) <= 1) {
+			stats.source = SearchStats::Source::Forced;
+			finish_clock(clock);
+			return bitboard::to_action(legal ? bitboard::lsb(legal) : bitboard::PASS);
 		}
-	};
 
+		std::vector<RootMove> moves;
+		for (uint64_t b = legal; b; b &= b - 1) {
+			int pos = bitboard::lsb(b);
+			moves.push_back({ pos, bitboard::flips(p, o, bitboard::bit(pos)), 0 });
+		}
+		for (auto& k : killers)k[0] = k[1] = (uint8_t)bitboard::PASS;
+		for (int& h : history)h /= 2;
 
-	std::pair<int, int> select_action(SimpleState state) {
-		Node root_node = Node(state);
-		root_node.expand();
-		for (int i = 0; i < MONTECALRO_TREE_SEARCH_COUNT; i++) {
-			root_node.evaluate(*this);
+		const int max_depth = limits.iterations > 0 ? limits.iterations : (clock.timed() ? MAX_PLY : ALPHABETA_DEPTH);
+		int best_pos = moves[0].pos;
+		int score = evaluate(p, o);
+		this->nodes = 0;
+		this->max_ply = 0;
+		this->next_check = 0;
+		this->aborted = false;
+		this->clock = nullptr;
+		for (int depth = 1; depth <= std::min(max_depth, state.empty_count()); depth++) {
+			auto iteration_start = clock.elapsed_ms();
+			int alpha = depth == 1 ? -INF : score - ALPHABETA_ASPIRATION, beta = depth == 1 ? INF : score + ALPHABETA_ASPIRATION;
+			int value;
+			while (true) {
+				value = search_root(p, o, depth, alpha, beta, moves);
+				if (this->aborted)break;
+				if (value <= alpha)alpha = -INF;
+				else if (value >= beta)beta = INF;
+				else break;
+			}
+			if (this->aborted)break;
+			score = value;
+			best_pos = moves[0].pos;
+			this->last_depth = depth;
+			this->last_score = score;
+			this->clock = &clock;
+			if (std::abs(score) >= WIN)break;
+			// ̐[͂悻{̂ŁAԂɍɂȂΎn߂Ȃ
+			if (clock.timed() && (clock.elapsed_ms() - iteration_start) * 3 > clock.remaining_ms())break;
 		}
-		auto legal_actions = state.legal_actions();
-		// pXȊOłȂpXO
-		if (legal_actions.size() > 1)legal_actions.pop_back();
+		this->clock = nullptr;
+		finish_clock(clock);
 
-		std::vector<int> n_list;
-		for (auto child_node : root_node.get_child_nodes()) {
-			n_list.push_back(child_node.get_n());
+		// ̎q̕]ĺAŌɓǂݏI[ŕבւ̂́B̊Oœǂ܂Ȃ͏
+		stats.iterations = this->last_depth;
+		stats.nodes = this->nodes;
+		stats.max_depth = this->max_ply;
+		stats.average_depth = this->last_depth;
+		stats.memory_bytes = table.size() * sizeof(HashEntry);
+		for (auto& move : moves) {
+			if (move.score > -INF)stats.add_root(move.pos, 0, (float)move.score);
 		}
-		int n_max = -10000;
-		int idx = -1;
-		for (int i = 0; i < legal_actions.size(); i++) {
-			if (n_list[i] > n_max) {
-				idx = i;
-				n_max = n_list[i];
+		return bitboard::to_action(best_pos);
+	}
+};
+
+// E]llbgg PUCTB؂ MonteCalroTreeAgent Ɠ NodeArena ŁAvCAEg̑Ƀlbg̕]l߂
+class PuctAgent :public Agent {
+private:
+	static const int VALUE_SCALE = 1024; // TreeNode::w ɂ͕]l̔{̐ő
+
+	NodeArena arena;
+	const PolicyValueNet* network;
+	uint64_t evaluations;
+
+	// lbgŕ]ĎqÅm prior ɓBA[itȂt̂܂ܕ]lԂ
+	float expand(uint32_t index, const SimpleState& state) {
+		uint64_t moves = state.legal_moves();
+		float policy[net::POLICY] = {}, value = 0;
+		if (network)network->evaluate(state.get_player(), state.get_opponent(), moves, policy, value);
+		evaluations++;
+		int count = moves ? bitboard::popcount(moves) : 1;
+		uint32_t first = arena.allocate(count);
+		if (first == NodeArena::INVALID)return value;
+
+		float max_logit = -INFINITY, sum = 0;
+		for (uint64_t b = moves; b; b &= b - 1)max_logit = std::max(max_logit, policy[bitboard::lsb(b)]);
+		for (uint64_t b = moves; b; b &= b - 1)sum += std::exp(policy[bitboard::lsb(b)] - max_logit);
+		for (int i = 0; i < count; i++) {
+			TreeNode& child = arena[first + i];
+			child = TreeNode();
+			if (moves) {
+				int pos = bitboard::lsb(moves);
+				moves &= moves - 1;
+				child.move = (uint8_t)pos;
+				child.prior = (uint8_t)std::clamp((int)std::lround(255 * std::exp(policy[pos] - max_logit) / sum), 1, 255);
+			}
+			else {
+				child.move = (uint8_t)bitboard::PASS;
+				child.prior = 255;
 			}
 		}
-		return legal_actions[idx];
+		arena[index].first_child = first;
+		arena[index].child_count = (uint8_t)count;
+		arena[index].expand_state.store(TreeNode::EXPANDED, std::memory_order_relaxed);
+		return value;
+	}
+
+	// Q + c * P * sqrt(N) / (1 + n) ő̎qBQ ͐e̎ԑ猩l
+	uint32_t select_child(uint32_t index) const {
+		const TreeNode& node = arena[index];
+		int parent_n = node.n.load(std::memory_order_relaxed);
+		double parent_q = parent_n > 0 ? node.w.load(std::memory_order_relaxed) / (double)(parent_n * VALUE_SCALE) : 0;
+		double exploration = PUCT_EXPLORATION * std::sqrt((double)std::max(1, parent_n)) / 255;
+		uint32_t best = node.first_child;
+		double best_score = -INFINITY;
+		for (uint32_t i = node.first_child; i < node.first_child + node.child_count; i++) {
+			int n = arena[i].n.load(std::memory_order_relaxed);
+			double q = n > 0 ? -arena[i].w.load(std::memory_order_relaxed) / (double)(n * VALUE_SCALE) : parent_q - PUCT_FPU_REDUCTION;
+			double score = q + exploration * arena[i].prior / (1 + n);
+			if (score > best_score) {
+				best_score = score;
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	// ~肽[Ԃ
+	int simulate(SimpleState state) {
+		uint32_t path[128];
+		int length = 0;
+		uint32_t index = 0;
+		float value;
+		while (true) {
+			path[length++] = index;
+			if (state.is_done()) {
+				int diff = state.disc_difference();
+				value = (float)((diff > 0) - (diff < 0));
+				break;
+			}
+			if (!arena[index].is_expanded()) {
+				value = expand(index, state);
+				break;
+			}
+			index = select_child(index);
+			state.make_move(arena[index].move);
+		}
+		// em[h w ́Ãm[h̎ԑ猩l
+		int v = (int)std::lround(value * VALUE_SCALE);
+		for (int i = length - 1; i >= 0; i--) {
+			arena[path[i]].w.fetch_add(v, std::memory_order_relaxed);
+			arena[path[i]].n.fetch_add(1, std::memory_order_relaxed);
+			v = -v;
+		}
+		return length - 1;
+	}
+
+	// c̉񐔂S 2 ʂɉ񂵂Ă 1 ʂ̖K񐔂ɓ͂ȂΑł؂Ă悢
+	bool decided(int remaining) const {
+		const TreeNode& root = arena[0];
+		int first = 0, second = 0;
+		for (uint32_t i = root.first_child; i < root.first_child + root.child_count; i++) {
+			int n = arena[i].n.load(std::memory_order_relaxed);
+			if (n > first) {
+				second = first;
+				first = n;
+			}
+			else if (n > second) {
+				second = n;
+			}
+		}
+		return first - second > remaining;
+	}
+
+public:
+	PuctAgent() :arena(MCTS_NODE_LIMIT), network(PolicyValueNet::shared()), evaluations(0) {
+		limits.iterations = PUCT_SEARCH_COUNT;
+		set_endgame_empties(ENDGAME_WLD_EMPTIES, ENDGAME_EXACT_EMPTIES);
+	}
+
+	void set_network(const PolicyValueNet* network) {
+		this->network = network;
+	}
+
+	// ܂łɃlbgŕ]ǖʂ̐
+	uint64_t get_evaluation_count() const {
+		return this->evaluations;
+	}
+
+	const char* name() const {
+		return "puct";
+	}
+
+protected:
+	// limits.iterations  1 肠̃V~[V
+	std::pair<int, int> think(SimpleState state) {
+		int book_move;
+		if (probe_book(state, book_move))return bitboard::to_action(book_move);
+		SearchClock clock = start_clock(state);
+		if (solve_endgame(state, clock)) {
+			finish_clock(clock);
+			return bitboard::to_action(last_solve.move);
+		}
+		uint64_t legal = state.legal_moves();
+		if (bitboard::popcount(legal) <= 1) {
+			stats.source = SearchStats::Source::Forced;
+			finish_clock(clock);
+			return bitboard::to_action(legal ? bitboard::lsb(legal) : bitboard::PASS);
+		}
+
+		uint64_t evaluations_before = evaluations;
+		arena.reset();
+		arena.allocate(1);
+		arena[0] = TreeNode();
+		const int iterations = limits.iterations > 0 ? limits.iterations : (clock.timed() ? INT_MAX : PUCT_SEARCH_COUNT);
+		int done = 0, max_depth = 0;
+		uint64_t depth_sum = 0;
+		for (int i = 0; i < iterations && !stop_requested(); i++) {
+			int depth = simulate(state);
+			done++;
+			depth_sum += depth;
+			max_depth = std::max(max_depth, depth);
+			if ((i + 1) % MCTS_TIME_CHECK_INTERVAL == 0) {
+				double remaining = std::min<double>(iterations - i - 1, clock.estimate_remaining(i + 1));
+				if (clock.past_deadline() || decided((int)std::min<double>(remaining, INT_MAX)))break;
+			}
+		}
+		finish_clock(clock);
+		stats.iterations = done;
+		stats.playouts = evaluations - evaluations_before;
+		stats.nodes = depth_sum;
+		stats.max_depth = max_depth;
+		stats.average_depth = done ? (double)depth_sum / done : 0;
+		stats.memory_bytes = (size_t)arena.size() * sizeof(TreeNode);
+		stats.committed_memory_bytes = arena.memory_usage();
+
+		const TreeNode& root = arena[0];
+		int move = bitboard::PASS, n_max = -1;
+		for (uint32_t i = root.first_child; i < root.first_child + root.child_count; i++) {
+			int n = arena[i].n.load(std::memory_order_relaxed);
+			stats.add_root(arena[i].move, n, n > 0 ? -arena[i].w.load(std::memory_order_relaxed) / (float)(n * VALUE_SCALE) : 0);
+			if (n > n_max) {
+				n_max = n;
+				move = arena[i].move;
+			}
+		}
+		return bitboard::to_action(move);
 	}
 };
\ No newline at end of file
@@ -0,0 +1,272 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include <bit>
+#include <cstdint>
+#include <utility>
+#if defined(_M_X64) || defined(__x86_64__)
+#define BITBOARD_X64
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BITBOARD_TARGET_AVX2
+#else
+#define BITBOARD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// 8x8 盤面のビットボード演算 (bit = y * 8 + x)
+namespace bitboard {
+	constexpr int SIZE = 8;
+	constexpr int CELLS = 64;
+	constexpr int PASS = 64;
+
+	// 横方向・斜め方向のシフトで反対側の列へ回り込まないためのマスク
+	constexpr uint64_t MASK_H = 0x7e7e7e7e7e7e7e7eULL;
+	constexpr uint64_t MASK_V = 0x00ffffffffffff00ULL;
+	constexpr uint64_t MASK_D = 0x007e7e7e7e7e7e00ULL;
+
+	inline int popcount(uint64_t b) {
+		return std::popcount(b);
+	}
+
+	inline int lsb(uint64_t b) {
+		return std::countr_zero(b);
+	}
+
+	inline uint64_t bit(int pos) {
+		return 1ULL << pos;
+	}
+
+	inline int to_pos(int y, int x) {
+		return y * SIZE + x;
+	}
+
+	inline std::pair<int, int> to_action(int pos) {
+		if (pos == PASS)return { -1, -1 };
+		return { pos / SIZE, pos % SIZE };
+	}
+
+	inline uint64_t flip_vertical(uint64_t b) {
+		b = ((b >> 8) & 0x00ff00ff00ff00ffULL) | ((b & 0x00ff00ff00ff00ffULL) << 8);
+		b = ((b >> 16) & 0x0000ffff0000ffffULL) | ((b & 0x0000ffff0000ffffULL) << 16);
+		return (b >> 32) | (b << 32);
+	}
+
+	inline uint64_t flip_horizontal(uint64_t b) {
+		b = ((b >> 1) & 0x5555555555555555ULL) | ((b & 0x5555555555555555ULL) << 1);
+		b = ((b >> 2) & 0x3333333333333333ULL) | ((b & 0x3333333333333333ULL) << 2);
+		return ((b >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((b & 0x0f0f0f0f0f0f0f0fULL) << 4);
+	}
+
+	// x と y を入れ替える
+	inline uint64_t transpose(uint64_t b) {
+		uint64_t t = 0x0f0f0f0f00000000ULL & (b ^ (b << 28));
+		b ^= t ^ (t >> 28);
+		t = 0x3333000033330000ULL & (b ^ (b << 14));
+		b ^= t ^ (t >> 14);
+		t = 0x5500550055005500ULL & (b ^ (b << 7));
+		return b ^ t ^ (t >> 7);
+	}
+
+	// 盤の 8 通りの対称形。bit 0 で左右、bit 1 で上下を反転してから、bit 2 で転置する
+	constexpr int SYMMETRY_COUNT = 8;
+
+	inline uint64_t symmetry(uint64_t b, int s) {
+		if (s & 1)b = flip_horizontal(b);
+		if (s & 2)b = flip_vertical(b);
+		if (s & 4)b = transpose(b);
+		return b;
+	}
+
+	inline uint64_t inverse_symmetry(uint64_t b, int s) {
+		if (s & 4)b = transpose(b);
+		if (s & 2)b = flip_vertical(b);
+		if (s & 1)b = flip_horizontal(b);
+		return b;
+	}
+
+	template <int S>
+	inline uint64_t shift(uint64_t b) {
+		if constexpr (S > 0) return b << S;
+		else return b >> -S;
+	}
+
+	// Kogge-Stone の occluded fill: gen から pro を伝って S 方向へ伸ばす
+	template <int S>
+	inline uint64_t fill(uint64_t gen, uint64_t pro) {
+		gen |= pro & shift<S>(gen);
+		pro &= shift<S>(pro);
+		gen |= pro & shift<2 * S>(gen);
+		pro &= shift<2 * S>(pro);
+		gen |= pro & shift<4 * S>(gen);
+		return gen;
+	}
+
+	template <int S>
+	inline uint64_t moves_dir(uint64_t p, uint64_t pro) {
+		return shift<S>(fill<S>(p, pro) & pro);
+	}
+
+	template <int S>
+	inline uint64_t flips_dir(uint64_t p, uint64_t pro, uint64_t move) {
+		uint64_t f = fill<S>(move, pro) & pro;
+		return (shift<S>(f) & p) ? f : 0;
+	}
+
+	inline uint64_t legal_moves_scalar(uint64_t p, uint64_t o) {
+		uint64_t h = o & MASK_H, v = o & MASK_V, d = o & MASK_D;
+		uint64_t moves = moves_dir<1>(p, h) | moves_dir<-1>(p, h)
+			| moves_dir<8>(p, v) | moves_dir<-8>(p, v)
+			| moves_dir<7>(p, d) | moves_dir<-7>(p, d)
+			| moves_dir<9>(p, d) | moves_dir<-9>(p, d);
+		return moves & ~(p | o);
+	}
+
+	inline uint64_t flips_scalar(uint64_t p, uint64_t o, uint64_t move) {
+		uint64_t h = o & MASK_H, v = o & MASK_V, d = o & MASK_D;
+		return flips_dir<1>(p, h, move) | flips_dir<-1>(p, h, move)
+			| flips_dir<8>(p, v, move) | flips_dir<-8>(p, v, move)
+			| flips_dir<7>(p, d, move) | flips_dir<-7>(p, d, move)
+			| flips_dir<9>(p, d, move) | flips_dir<-9>(p, d, move);
+	}
+
+#ifdef BITBOARD_X64
+	// 4 レーンに (1, 8, 9, 7) 方向を載せ、左右シフトで 8 方向を同時に処理する
+	BITBOARD_TARGET_AVX2 inline uint64_t legal_moves_avx2(uint64_t p, uint64_t o) {
+		const __m256i s1 = _mm256_set_epi64x(7, 9, 8, 1);
+		const __m256i s2 = _mm256_add_epi64(s1, s1);
+		const __m256i s4 = _mm256_add_epi64(s2, s2);
+		const __m256i PP = _mm256_set1_epi64x((long long)p);
+		const __m256i OO = _mm256_and_si256(_mm256_set1_epi64x((long long)o),
+			_mm256_set_epi64x((long long)MASK_D, (long long)MASK_D, (long long)MASK_V, (long long)MASK_H));
+
+		__m256i gl = PP, pl = OO, gr = PP, pr = OO;
+		gl = _mm256_or_si256(gl, _mm256_and_si256(pl, _mm256_sllv_epi64(gl, s1)));
+		gr = _mm256_or_si256(gr, _mm256_and_si256(pr, _mm256_srlv_epi64(gr, s1)));
+		pl = _mm256_and_si256(pl, _mm256_sllv_epi64(pl, s1));
+		pr = _mm256_and_si256(pr, _mm256_srlv_epi64(pr, s1));
+		gl = _mm256_or_si256(gl, _mm256_and_si256(pl, _mm256_sllv_epi64(gl, s2)));
+		gr = _mm256_or_si256(gr, _mm256_and_si256(pr, _mm256_srlv_epi64(gr, s2)));
+		pl = _mm256_and_si256(pl, _mm256_sllv_epi64(pl, s2));
+		pr = _mm256_and_si256(pr, _mm256_srlv_epi64(pr, s2));
+		gl = _mm256_or_si256(gl, _mm256_and_si256(pl, _mm256_sllv_epi64(gl, s4)));
+		gr = _mm256_or_si256(gr, _mm256_and_si256(pr, _mm256_srlv_epi64(gr, s4)));
+
+		__m256i m = _mm256_or_si256(_mm256_sllv_epi64(_mm256_and_si256(gl, OO), s1),
+			_mm256_srlv_epi64(_mm256_and_si256(gr, OO), s1));
+		__m128i x = _mm_or_si128(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+		x = _mm_or_si128(x, _mm_unpackhi_epi64(x, x));
+		return (uint64_t)_mm_cvtsi128_si64(x) & ~(p | o);
+	}
+
+	BITBOARD_TARGET_AVX2 inline uint64_t flips_avx2(uint64_t p, uint64_t o, uint64_t move) {
+		const __m256i s1 = _mm256_set_epi64x(7, 9, 8, 1);
+		const __m256i s2 = _mm256_add_epi64(s1, s1);
+		const __m256i s4 = _mm256_add_epi64(s2, s2);
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i PP = _mm256_set1_epi64x((long long)p);
+		const __m256i MM = _mm256_set1_epi64x((long long)move);
+		const __m256i OO = _mm256_and_si256(_mm256_set1_epi64x((long long)o),
+			_mm256_set_epi64x((long long)MASK_D, (long long)MASK_D, (long long)MASK_V, (long long)MASK_H));
+
+		__m256i gl = MM, pl = OO, gr = MM, pr = OO;
+		gl = _mm256_or_si256(gl, _mm256_and_si256(pl, _mm256_sllv_epi64(gl, s1)));
+		gr = _mm256_or_si256(gr, _mm256_and_si256(pr, _mm256_srlv_epi64(gr, s1)));
+		pl = _mm256_and_si256(pl, _mm256_sllv_epi64(pl, s1));
+		pr = _mm256_and_si256(pr, _mm256_srlv_epi64(pr, s1));
+		gl = _mm256_or_si256(gl, _mm256_and_si256(pl, _mm256_sllv_epi64(gl, s2)));
+		gr = _mm256_or_si256(gr, _mm256_and_si256(pr, _mm256_srlv_epi64(gr, s2)));
+		pl = _mm256_and_si256(pl, _mm256_sllv_epi64(pl, s2));
+		pr = _mm256_and_si256(pr, _mm256_srlv_epi64(pr, s2));
+		gl = _mm256_or_si256(gl, _mm256_and_si256(pl, _mm256_sllv_epi64(gl, s4)));
+		gr = _mm256_or_si256(gr, _mm256_and_si256(pr, _mm256_srlv_epi64(gr, s4)));
+		gl = _mm256_and_si256(gl, OO);
+		gr = _mm256_and_si256(gr, OO);
+
+		// 自石で挟めていない方向は捨てる
+		__m256i bl = _mm256_and_si256(_mm256_sllv_epi64(gl, s1), PP);
+		__m256i br = _mm256_and_si256(_mm256_srlv_epi64(gr, s1), PP);
+		gl = _mm256_andnot_si256(_mm256_cmpeq_epi64(bl, zero), gl);
+		gr = _mm256_andnot_si256(_mm256_cmpeq_epi64(br, zero), gr);
+
+		__m256i f = _mm256_or_si256(gl, gr);
+		__m128i x = _mm_or_si128(_mm256_castsi256_si128(f), _mm256_extracti128_si256(f, 1));
+		x = _mm_or_si128(x, _mm_unpackhi_epi64(x, x));
+		return (uint64_t)_mm_cvtsi128_si64(x);
+	}
+
+	inline bool cpu_has_avx2() {
+#if defined(_MSC_VER)
+		int r[4];
+		__cpuid(r, 0);
+		if (r[0] < 7)return false;
+		__cpuid(r, 1);
+		bool osxsave = (r[2] & (1 << 27)) != 0, avx = (r[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)return false;
+		__cpuidex(r, 7, 0);
+		return (r[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+	struct Kernel {
+		const char* name;
+		uint64_t(*legal_moves)(uint64_t p, uint64_t o);
+		uint64_t(*flips)(uint64_t p, uint64_t o, uint64_t move);
+	};
+
+	inline const Kernel SCALAR_KERNEL = { "scalar", legal_moves_scalar, flips_scalar };
+#ifdef BITBOARD_X64
+	inline const Kernel AVX2_KERNEL = { "avx2", legal_moves_avx2, flips_avx2 };
+#endif
+
+	// 初期局面からの perft の既知の値 (PERFT_COUNTS[d] が深さ d の葉の数)
+	constexpr uint64_t PERFT_COUNTS[] = { 1, 4, 12, 56, 244, 1396, 8200, 55092, 390216, 3005288, 24571284 };
+	constexpr uint64_t INITIAL_PLAYER = 0x0000000810000000ULL;
+	constexpr uint64_t INITIAL_OPPONENT = 0x0000001008000000ULL;
+
+	// パスも 1 手として数え、両者とも打てなければ終局として葉扱いにする
+	inline uint64_t perft(const Kernel& kernel, uint64_t p, uint64_t o, int depth, bool passed = false) {
+		if (depth == 0)return 1;
+		uint64_t moves = kernel.legal_moves(p, o);
+		if (moves == 0) {
+			if (passed)return 1;
+			return perft(kernel, o, p, depth - 1, true);
+		}
+		uint64_t count = 0;
+		for (; moves; moves &= moves - 1) {
+			uint64_t move = moves & (0 - moves);
+			uint64_t f = kernel.flips(p, o, move);
+			count += perft(kernel, o & ~f, p | move | f, depth - 1);
+		}
+		return count;
+	}
+
+	inline bool validate_kernel(const Kernel& kernel, int depth = 6) {
+		for (int d = 1; d <= depth; d++) {
+			if (perft(kernel, INITIAL_PLAYER, INITIAL_OPPONENT, d) != PERFT_COUNTS[d])return false;
+		}
+		return true;
+	}
+
+	// CPUID で使える命令セットを調べ、perft が合うものだけを採用する
+	inline const Kernel& select_kernel() {
+#ifdef BITBOARD_X64
+		if (cpu_has_avx2() && validate_kernel(AVX2_KERNEL))return AVX2_KERNEL;
+#endif
+		return SCALAR_KERNEL;
+	}
+
+	inline const Kernel& kernel = select_kernel();
+
+	inline uint64_t legal_moves(uint64_t p, uint64_t o) {
+		return kernel.legal_moves(p, o);
+	}
+
+	inline uint64_t flips(uint64_t p, uint64_t o, uint64_t move) {
+		return kernel.flips(p, o, move);
+	}
+}
\ No newline at end of file
@@ -1,12 +1,10 @@
 #pragma once
 #include <Siv3D.hpp>
+#include "EngineDefine.h"
 #include "State.cpp"
 #include "GameData.cpp"
 
 using MyApp = SceneManager<State, GameData>;
 
 
-const int MONTECALRO_SEARCH_COUNT = 500;
-
-const int MCTS_EXPAND_LIMIT = 10;
-const int MONTECALRO_TREE_SEARCH_COUNT = 500;
\ No newline at end of file
+const bool CPU_PONDERING = true;
\ No newline at end of file
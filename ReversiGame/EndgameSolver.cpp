@@ -0,0 +1,250 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "SimpleState.cpp"
+#include <chrono>
+#include <functional>
+
+enum class SolveMode {
+	WinLossDraw, // 勝ち・引き分け・負けだけを読み切る
+	Exact,       // 最終的な石差まで読み切る
+};
+
+struct SolveResult {
+	int move = bitboard::PASS; // 0..63、打てる手がなければ bitboard::PASS
+	int score = 0;             // 手番側から見た値。WinLossDraw なら 1, 0, -1、Exact なら石差
+	uint64_t nodes = 0;
+	double ms = 0;
+	bool aborted = false;      // 打ち切られた場合 move と score は使えない
+
+	double nodes_per_sec() const {
+		return this->ms > 0 ? this->nodes * 1000.0 / this->ms : 0;
+	}
+};
+
+// 終盤の完全読み。negascout に置換表をつけ、手は 偶数理論 (空きが奇数の象限を先に) と 速さ優先 (相手の着手可能数が少ない手を先に) で並べる
+// 残り 4 マス以下は合法手を作らずに空きマスを直接試し、最後の 1 マスは専用の関数で数える
+class EndgameSolver {
+private:
+	static const int INF = bitboard::CELLS + 1;
+	static const int SMALL_EMPTIES = 4;
+	static const int FASTEST_FIRST_EMPTIES = 7;
+	static const int HASH_MIN_EMPTIES = 7;
+	static const uint64_t QUADRANTS[4];
+
+	// 下限と上限は手番側から見た石差
+	struct HashEntry {
+		uint64_t player;
+		uint64_t opponent;
+		int8_t lower;
+		int8_t upper;
+		uint8_t move;
+	};
+
+	std::vector<HashEntry> hash_table;
+	uint64_t nodes;
+	uint64_t next_check;
+	bool aborted;
+	std::function<bool()> should_stop;
+
+	static int final_score(uint64_t p, uint64_t o) {
+		return bitboard::popcount(p) - bitboard::popcount(o);
+	}
+
+	// 空きマスが奇数個ある象限のマス
+	static uint64_t odd_quadrants(uint64_t empty) {
+		uint64_t odd = 0;
+		for (uint64_t quadrant : QUADRANTS) {
+			if (bitboard::popcount(empty & quadrant) & 1)odd |= quadrant;
+		}
+		return odd;
+	}
+
+	HashEntry& hash_entry(uint64_t p, uint64_t o) {
+		uint64_t h = p * 0x9e3779b97f4a7c15ULL ^ o * 0xc2b2ae3d27d4eb4fULL;
+		h ^= h >> 29;
+		return this->hash_table[h & (this->hash_table.size() - 1)];
+	}
+
+	bool check_stop() {
+		if (this->nodes >= this->next_check) {
+			this->next_check = this->nodes + 4096;
+			if (this->should_stop && this->should_stop())this->aborted = true;
+		}
+		return this->aborted;
+	}
+
+	int solve_last1(uint64_t p, uint64_t o, uint64_t move) {
+		this->nodes++;
+		int score = final_score(p, o);
+		if (uint64_t f = bitboard::flips(p, o, move)) {
+			return score + 1 + 2 * bitboard::popcount(f);
+		}
+		if (uint64_t f = bitboard::flips(o, p, move)) {
+			return score - 1 - 2 * bitboard::popcount(f);
+		}
+		return score;
+	}
+
+	// 残りが少ないので合法手は作らず、空きマスに打ってみて返せるかで判定する
+	int solve_small(uint64_t p, uint64_t o, int alpha, int beta, bool passed, int empties) {
+		uint64_t empty = ~(p | o);
+		if (empties == 1)return solve_last1(p, o, empty);
+		this->nodes++;
+		uint64_t odd = odd_quadrants(empty);
+		int best = -INF;
+		for (uint64_t group : { empty & odd, empty & ~odd }) {
+			for (; group; group &= group - 1) {
+				uint64_t move = group & (0 - group);
+				uint64_t f = bitboard::flips(p, o, move);
+				if (!f)continue;
+				int score = -solve_small(o & ~f, p | move | f, -beta, -alpha, false, empties - 1);
+				if (score > best) {
+					best = score;
+					if (best > alpha) {
+						alpha = best;
+						if (alpha >= beta)return best;
+					}
+				}
+			}
+		}
+		if (best == -INF) {
+			if (passed)return final_score(p, o);
+			return -solve_small(o, p, -beta, -alpha, true, empties);
+		}
+		return best;
+	}
+
+	struct Move {
+		uint64_t bit;
+		uint64_t flips;
+		int key;
+	};
+
+	// 置換表の手 > 空きが奇数の象限 > 相手の着手可能数が少ない の順
+	int order_moves(uint64_t p, uint64_t o, uint64_t moves, int hash_move, int empties, Move* list) {
+		uint64_t odd = odd_quadrants(~(p | o));
+		int count = 0;
+		for (; moves; moves &= moves - 1) {
+			Move& m = list[count++];
+			m.bit = moves & (0 - moves);
+			m.flips = bitboard::flips(p, o, m.bit);
+			m.key = 0;
+			if (bitboard::lsb(m.bit) == hash_move)m.key += 1 << 20;
+			if (m.bit & odd)m.key += 1 << 8;
+			if (empties >= FASTEST_FIRST_EMPTIES) {
+				m.key -= bitboard::popcount(bitboard::legal_moves(o & ~m.flips, p | m.bit | m.flips)) << 10;
+			}
+		}
+		std::sort(list, list + count, [](const Move& a, const Move& b) { return a.key > b.key; });
+		return count;
+	}
+
+	int search(uint64_t p, uint64_t o, int alpha, int beta, bool passed, int* best_move = nullptr) {
+		if (check_stop())return 0;
+		int empties = bitboard::CELLS - bitboard::popcount(p | o);
+		if (empties <= SMALL_EMPTIES && !best_move)return solve_small(p, o, alpha, beta, passed, empties);
+		this->nodes++;
+
+		uint64_t moves = bitboard::legal_moves(p, o);
+		if (!moves) {
+			if (best_move)*best_move = bitboard::PASS;
+			if (passed)return final_score(p, o);
+			return -search(o, p, -beta, -alpha, true);
+		}
+
+		HashEntry* entry = nullptr;
+		int hash_move = bitboard::PASS;
+		if (empties >= HASH_MIN_EMPTIES) {
+			entry = &hash_entry(p, o);
+			if (entry->player == p && entry->opponent == o) {
+				hash_move = entry->move;
+				if (!best_move) {
+					if (entry->lower >= beta)return entry->lower;
+					if (entry->upper <= alpha)return entry->upper;
+					alpha = std::max(alpha, (int)entry->lower);
+					beta = std::min(beta, (int)entry->upper);
+				}
+			}
+		}
+
+		Move list[bitboard::CELLS];
+		int count = order_moves(p, o, moves, hash_move, empties, list);
+		int original_alpha = alpha;
+		int best = -INF, move = bitboard::lsb(list[0].bit);
+		for (int i = 0; i < count; i++) {
+			uint64_t next_p = o & ~list[i].flips, next_o = p | list[i].bit | list[i].flips;
+			int score;
+			if (i == 0) {
+				score = -search(next_p, next_o, -beta, -alpha, false);
+			}
+			else {
+				score = -search(next_p, next_o, -alpha - 1, -alpha, false);
+				if (alpha < score && score < beta) {
+					score = -search(next_p, next_o, -beta, -score, false);
+				}
+			}
+			if (this->aborted)return 0;
+			if (score > best) {
+				best = score;
+				move = bitboard::lsb(list[i].bit);
+				if (best > alpha) {
+					alpha = best;
+					if (alpha >= beta)break;
+				}
+			}
+		}
+
+		if (entry) {
+			entry->player = p;
+			entry->opponent = o;
+			entry->lower = (int8_t)(best >= beta ? best : (best > original_alpha ? best : -INF));
+			entry->upper = (int8_t)(best <= original_alpha ? best : (best < beta ? best : INF));
+			entry->move = (uint8_t)move;
+		}
+		if (best_move)*best_move = move;
+		return best;
+	}
+
+public:
+	explicit EndgameSolver(int hash_bits = ENDGAME_HASH_BITS) :hash_table((size_t)1 << hash_bits), nodes(0), next_check(0), aborted(false) {
+		clear();
+	}
+
+	void clear() {
+		for (HashEntry& entry : this->hash_table) {
+			entry = { 0, 0, (int8_t)-INF, (int8_t)INF, (uint8_t)bitboard::PASS };
+		}
+	}
+
+	// should_stop は数千ノードごとに呼ばれ、true を返すと探索をやめる
+	SolveResult solve(const SimpleState& state, SolveMode mode, std::function<bool()> should_stop = nullptr) {
+		auto start = std::chrono::steady_clock::now();
+		this->nodes = 0;
+		this->next_check = 0;
+		this->aborted = false;
+		this->should_stop = std::move(should_stop);
+
+		SolveResult result;
+		uint64_t p = state.get_player(), o = state.get_opponent();
+		if (state.is_done()) {
+			result.score = final_score(p, o);
+		}
+		else if (mode == SolveMode::WinLossDraw) {
+			result.score = search(p, o, -1, 1, false, &result.move);
+		}
+		else {
+			result.score = search(p, o, -INF, INF, false, &result.move);
+		}
+		if (mode == SolveMode::WinLossDraw) {
+			result.score = (result.score > 0) - (result.score < 0);
+		}
+		result.nodes = this->nodes;
+		result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		result.aborted = this->aborted;
+		return result;
+	}
+};
+
+inline const uint64_t EndgameSolver::QUADRANTS[4] = {
+	0x000000000F0F0F0FULL, 0x00000000F0F0F0F0ULL, 0x0F0F0F0F00000000ULL, 0xF0F0F0F000000000ULL,
+};
\ No newline at end of file
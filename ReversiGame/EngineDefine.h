@@ -0,0 +1,59 @@
+﻿#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+const int MONTECALRO_SEARCH_COUNT = 500;
+const int MONTECALRO_PLAYOUT_CHUNK = 50;
+const int MONTECALRO_THREAD_COUNT = 0;
+
+const int MCTS_EXPAND_LIMIT = 10;
+const int MONTECALRO_TREE_SEARCH_COUNT = 500;
+const int MCTS_TIME_CHECK_INTERVAL = 64;
+const int MCTS_THREAD_COUNT = 0;
+const int MCTS_VIRTUAL_LOSS = 1;
+const int MCTS_NODE_LIMIT = 1 << 20; // 木のノード数の上限。同じ大きさの詰め直し用の領域と合わせて 2 倍を確保する
+const double MCTS_RAVE_EQUIVALENCE = 500; // RAVE を使うとき、子の訪問がこの回数の 1/3 で RAVE と実際の勝率を半々に混ぜる
+const double MCTS_RAVE_EXPLORATION = 0.5; // RAVE を使うときの UCB の探索項の係数 (使わなければ sqrt(2))
+const int MCTS_WIDENING_BASE = 3;      // 漸進的展開で最初から選べる子の数
+const int MCTS_WIDENING_VISITS = 10;   // 親の訪問がこの回数の 2 倍、4 倍、... になるたびに子を 1 つずつ足す
+const double MCTS_PRUNE_KEEP = 0.5; // 木が上限に達したら訪問の少ない部分木を切り、上限のこの割合まで詰め直して探索を続ける。0 なら切らずに展開をやめる
+const int MCTS_TT_SIZE_MB = 0; // 置換表の大きさ (MB)。0 で使わない。既定の探索回数では強くならなかったので、使うときは tt=N で指定する
+const int MCTS_BATCH_SIZE = 8; // 1 スレッドが仮想敗北を付けながら集めて、まとめて評価する葉の数
+const int MCTS_MAX_BATCH_SIZE = 256;
+
+const int ALPHABETA_DEPTH = 8;
+const int ALPHABETA_ASPIRATION = 40;
+const int ALPHABETA_HASH_BITS = 18;
+
+const char* const PATTERN_WEIGHT_FILE = "pattern.weights"; // 無ければパターン評価は使わない
+const int MCTS_PLAYOUT_CUTOFF = 4; // パターン評価があれば、プレイアウトをこの手数で打ち切って評価値の符号を結果にする。0 で最後まで打つ
+
+const char* const OPENING_BOOK_FILE = "opening.book"; // 無ければ定跡は使わない
+const int BOOK_MIN_GAMES = 4; // これより少ない局数しか打たれていない定跡手は使わない
+
+const char* const NET_WEIGHT_FILE = "policy.net"; // 無ければ PUCT は一様な方策と評価値 0 で探索する
+const int PUCT_SEARCH_COUNT = 400;
+const double PUCT_EXPLORATION = 1.5;
+const double PUCT_FPU_REDUCTION = 0.2; // 未訪問の子は親の評価値からこれだけ引いた値とみなす
+
+const int SIZED_PLAYOUT_COUNT = 100; // 8x8 以外の盤で、CPU の強さ 1 段ごとに合法手 1 つあたり打つプレイアウト数
+
+const int ENDGAME_WLD_EMPTIES = 16;   // 空きがこれ以下なら勝敗を読み切る。0 で使わない
+const int ENDGAME_EXACT_EMPTIES = 14; // 空きがこれ以下なら石差まで読み切る
+const int ENDGAME_HASH_BITS = 16;
+
+const char* const SEARCH_TRACE_FILE = "search_trace.jsonl"; // CPU の 1 手ごとの探索の記録を追記する。空なら書かない
+
+const int TIME_MIN_MOVES_LEFT = 4;
\ No newline at end of file
@@ -0,0 +1,104 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "Bitboard.cpp"
+
+// 静的評価関数。着手可能数・開放度・角・確定石を全部ビット演算で数える
+namespace evaluator {
+	constexpr uint64_t CORNERS = 0x8100000000000081ULL;
+	constexpr uint64_t EDGES = 0xff818181818181ffULL;
+	constexpr uint64_t FILE_A = 0x0101010101010101ULL;
+	constexpr uint64_t FILE_H = 0x8080808080808080ULL;
+	constexpr uint64_t RANK_1 = 0x00000000000000ffULL;
+	constexpr uint64_t RANK_8 = 0xff00000000000000ULL;
+
+	constexpr int W_CORNER = 60;
+	constexpr int W_STABLE = 12;
+	constexpr int W_MOBILITY = 8;
+	constexpr int W_FRONTIER = 4;
+	constexpr int W_X_SQUARE = 25;
+
+	// 読まずに手を並べるときの目安。角、C 打ちでない辺、内側、C 打ち、X 打ちの順に良い手とみなす
+	constexpr uint64_t C_SQUARES = 0x4281000000008142ULL;
+	constexpr uint64_t X_SQUARES = 0x0042000000004200ULL;
+	constexpr uint64_t MOVE_ORDER[] = { CORNERS, EDGES & ~CORNERS & ~C_SQUARES, ~EDGES & ~X_SQUARES, C_SQUARES, X_SQUARES };
+
+	// 斜めの 15 本ずつの筋
+	struct DiagonalLines {
+		uint64_t down[15]; // x - y が一定
+		uint64_t up[15];   // x + y が一定
+	};
+
+	constexpr DiagonalLines make_lines() {
+		DiagonalLines lines = {};
+		for (int y = 0; y < bitboard::SIZE; y++) {
+			for (int x = 0; x < bitboard::SIZE; x++) {
+				lines.down[x - y + 7] |= 1ULL << (y * 8 + x);
+				lines.up[x + y] |= 1ULL << (y * 8 + x);
+			}
+		}
+		return lines;
+	}
+
+	inline constexpr DiagonalLines LINES = make_lines();
+
+	// 8 方向の隣のマス
+	inline uint64_t neighbors(uint64_t b) {
+		uint64_t h = ((b << 1) & ~FILE_A) | ((b >> 1) & ~FILE_H);
+		uint64_t row = b | h;
+		return h | (row << 8) | (row >> 8);
+	}
+
+	// 空きマスに接している石
+	inline uint64_t frontier(uint64_t stones, uint64_t empty) {
+		return stones & neighbors(empty);
+	}
+
+	// 4 つの軸それぞれで、筋が埋まっているか、片側が盤の端か確定石なら確定石とみなす (辺から伸ばす近似)
+	inline uint64_t stable_discs(uint64_t p, uint64_t o) {
+		uint64_t filled = p | o;
+		uint64_t full_h = 0, full_d1 = 0, full_d2 = 0;
+		for (int y = 0; y < bitboard::SIZE; y++) {
+			uint64_t row = RANK_1 << (8 * y);
+			if ((filled & row) == row)full_h |= row;
+		}
+		uint64_t column = filled & (filled >> 32);
+		column &= column >> 16;
+		column &= column >> 8;
+		uint64_t full_v = (column & 0xff) * FILE_A;
+		for (int i = 0; i < 15; i++) {
+			if ((filled & LINES.down[i]) == LINES.down[i])full_d1 |= LINES.down[i];
+			if ((filled & LINES.up[i]) == LINES.up[i])full_d2 |= LINES.up[i];
+		}
+
+		uint64_t stable = 0;
+		while (true) {
+			uint64_t h = full_h | FILE_A | FILE_H | ((stable << 1) & ~FILE_A) | ((stable >> 1) & ~FILE_H);
+			uint64_t v = full_v | RANK_1 | RANK_8 | (stable << 8) | (stable >> 8);
+			uint64_t d1 = full_d1 | EDGES | ((stable << 9) & ~FILE_A) | ((stable >> 9) & ~FILE_H);
+			uint64_t d2 = full_d2 | EDGES | ((stable << 7) & ~FILE_H) | ((stable >> 7) & ~FILE_A);
+			uint64_t next = p & h & v & d1 & d2;
+			if (next == stable)return stable;
+			stable = next;
+		}
+	}
+
+	// 角が空いているのに X 打ちしている石
+	inline uint64_t x_squares(uint64_t stones, uint64_t empty) {
+		uint64_t corners = CORNERS & empty;
+		uint64_t x = ((corners & 0x0000000000000001ULL) << 9) | ((corners & 0x0000000000000080ULL) << 7)
+			| ((corners & 0x0100000000000000ULL) >> 7) | ((corners & 0x8000000000000000ULL) >> 9);
+		return stones & x;
+	}
+
+	// 手番側 p から見た評価値。石 1 個の差がおよそ W_STABLE 程度になる尺度
+	inline int evaluate(uint64_t p, uint64_t o) {
+		uint64_t empty = ~(p | o);
+		int score = 0;
+		score += W_CORNER * (bitboard::popcount(p & CORNERS) - bitboard::popcount(o & CORNERS));
+		score += W_STABLE * (bitboard::popcount(stable_discs(p, o)) - bitboard::popcount(stable_discs(o, p)));
+		score += W_MOBILITY * (bitboard::popcount(bitboard::legal_moves(p, o)) - bitboard::popcount(bitboard::legal_moves(o, p)));
+		score += W_FRONTIER * (bitboard::popcount(frontier(o, empty)) - bitboard::popcount(frontier(p, empty)));
+		score += W_X_SQUARE * (bitboard::popcount(x_squares(o, empty)) - bitboard::popcount(x_squares(p, empty)));
+		return score;
+	}
+}
\ No newline at end of file
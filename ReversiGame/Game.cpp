@@ -2,6 +2,8 @@
 #include "Define.h"
 #include "SimpleState.cpp"
 #include "Agent.cpp"
+#include "SizedBoard.cpp"
+#include <future>
 
 enum CellState {
 	None = -1,
@@ -15,7 +17,7 @@ private:
 	const static int OFFSET = 20;
 	int m_height, m_width;
 	int m_cell_size;
-	SimpleState state;
+	AnyState state;
 
 
 	class Cell {
@@ -79,9 +81,11 @@ private:
 
 
 public:
-	GameState(std::initializer_list<std::initializer_list<int>> init) {
-		std::vector<std::vector<int>> tmp_board(init.begin(), init.end());
-		state = SimpleState(tmp_board, 0);
+	GameState(std::initializer_list<std::initializer_list<int>> init) :GameState(std::vector<std::vector<int>>(init.begin(), init.end())) {}
+
+	// Ղ̑傫 (6, 8, 10) ɍ^̋ǖʂ
+	GameState(const std::vector<std::vector<int>>& tmp_board) {
+		state = make_any_state(tmp_board, 0);
 		m_height = tmp_board.size();
 		m_width = tmp_board[0].size();
 		m_cell_size = BOARD_HEIGHT / m_height;
@@ -92,10 +96,11 @@ public:
 	void update_board() {
 		for (int i = 0; i < m_height; i++) {
 			for (int j = 0; j < m_width; j++) {
-				this->m_board[i][j] = Cell(CellState(this->state.getColor(i, j)), i, j, m_cell_size);
+				int color = std::visit([i, j](const auto& s) { return s.getColor(i, j); }, this->state);
+				this->m_board[i][j] = Cell(CellState(color), i, j, m_cell_size);
 			}
 		}
-		auto legal_actions = state.legal_actions();
+		auto legal_actions = std::visit([](const auto& s) { return s.legal_actions(); }, this->state);
 		for (int i = 0; i < m_height; i++) {
 			for (int j = 0; j < m_width; j++) {
 				m_board[i][j].set_clickable(false);
@@ -109,11 +114,13 @@ public:
 	}
 
 	int get_black_count() const {
-		return is_first_turn() ? this->state.stone_count().first : this->state.stone_count().second;
+		auto [mine, theirs] = std::visit([](const auto& s) { return s.stone_count(); }, this->state);
+		return is_first_turn() ? mine : theirs;
 	}
 
 	int get_white_count() const {
-		return is_first_turn() ? this->state.stone_count().second : this->state.stone_count().first;
+		auto [mine, theirs] = std::visit([](const auto& s) { return s.stone_count(); }, this->state);
+		return is_first_turn() ? theirs : mine;
 	}
 
 	int get_stone_count() const {
@@ -121,11 +128,15 @@ public:
 	}
 
 	bool is_terminal() const {
-		return state.is_done();
+		return std::visit([](const auto& s) { return s.is_done(); }, this->state);
 	}
 
 	bool is_first_turn() const {
-		return state.teban() == 0;
+		return std::visit([](const auto& s) { return s.teban(); }, this->state) == 0;
+	}
+
+	const AnyState& get_state() const {
+		return state;
 	}
 
 	void update(bool pass) {
@@ -150,13 +161,8 @@ public:
 		}
 	}
 
-	void update_by_cpu(Agent& agent) {
-		auto [y, x] = agent.select_action(this->state);
-		take_action(y, x);
-	}
-
 	void take_action(int y, int x) {
-		this->state = state.next(std::make_pair(y, x));
+		this->state = std::visit([y, x](const auto& s) { return AnyState(s.next(std::make_pair(y, x))); }, this->state);
 		update_board();
 	}
 
@@ -178,9 +184,83 @@ private:
 	Rect m_passButton = Rect(Arg::center = Scene::Center().movedBy(250, 150), 200, 60);
 	Transition m_passTransition = Transition(0.4s, 0.2s);
 	std::unique_ptr<Agent> agent;
+	std::future<std::pair<int, int>> cpu_action;
+	std::future<void> ponder_task;
+	SearchTrace trace;
+	std::vector<String> stats_text; // O CPU ̎̒T̋L^B󂯎ƂɍĂ
+
+	//  a..hAs 1..8 ŕ\
+	static String move_name(int pos) {
+		if (pos == bitboard::PASS)return U"pX";
+		return String(1, U'a' + pos % bitboard::SIZE) + String(1, U'1' + pos / bitboard::SIZE);
+	}
+
+	void record_stats(const SearchStats& stats) {
+		trace.write(stats);
+		stats_text.clear();
+		stats_text.push_back(U"{} ({})"_fmt(Unicode::Widen(stats.agent), Unicode::Widen(SearchStats::source_name(stats.source))));
+		stats_text.push_back(U"{:.1f} ms  {} "_fmt(stats.wall_ms, stats.iterations));
+		stats_text.push_back(U"{:.0f}k nodes/s  {} playouts"_fmt(stats.nodes_per_sec / 1000, stats.playouts));
+		stats_text.push_back(U"[ ő {}  {:.1f}"_fmt(stats.max_depth, stats.average_depth));
+		stats_text.push_back(stats.prunes ? U" {:.2f} / m {:.2f} MB (ő {:.2f} MB, 荞 {} )"_fmt(stats.memory_bytes / 1048576.0,
+			stats.committed_memory_bytes / 1048576.0, stats.peak_memory_bytes / 1048576.0, stats.prunes)
+			: U" {:.2f} / m {:.2f} MB"_fmt(stats.memory_bytes / 1048576.0, stats.committed_memory_bytes / 1048576.0));
+		// ̎q͖K (alpha-beta ł͕]l) ̑ 3 
+		std::vector<SearchStats::RootMove> root(stats.root, stats.root + stats.root_count);
+		std::sort(root.begin(), root.end(), [](const SearchStats::RootMove& a, const SearchStats::RootMove& b) {
+			return a.visits != b.visits ? a.visits > b.visits : a.value > b.value;
+		});
+		for (int i = 0; i < std::min<int>(3, (int)root.size()); i++) {
+			stats_text.push_back(U"{} {} ({:.2f})"_fmt(move_name(root[i].move), root[i].visits, root[i].value));
+		}
+	}
+
+	// T͕ʃXbhő点At[ImF
+	// 8x8 ̔Ղ̓G[WFgTAȊȎ傫̓vCAEg̃eJőł
+	void update_cpu() {
+		if (!cpu_action.valid()) {
+			stop_pondering();
+			agent->clear_stop();
+			int playouts = SIZED_PLAYOUT_COUNT * getData().cpuType;
+			cpu_action = std::async(std::launch::async, [agent = agent.get(), state = board.get_state(), playouts]() {
+				return std::visit([agent, playouts](const auto& s) {
+					if constexpr (std::is_same_v<std::decay_t<decltype(s)>, SimpleState>) {
+						return agent->select_action(s);
+					}
+					else {
+						Xoshiro256 rng(std::random_device{}());
+						return sized::monte_carlo_action(s, playouts, rng);
+					}
+				}, state);
+			});
+		}
+		if (cpu_action.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			auto [y, x] = cpu_action.get();
+			if (std::holds_alternative<SimpleState>(board.get_state()))record_stats(agent->get_last_stats());
+			board.take_action(y, x);
+		}
+	}
+
+	void update_human(bool is_pass) {
+		if (CPU_PONDERING && !ponder_task.valid() && !board.is_terminal() && std::holds_alternative<SimpleState>(board.get_state())) {
+			agent->clear_stop();
+			ponder_task = std::async(std::launch::async, [agent = agent.get(), state = std::get<SimpleState>(board.get_state())]() {
+				agent->ponder(state);
+			});
+		}
+		board.update(is_pass);
+	}
+
+	void stop_pondering() {
+		if (ponder_task.valid()) {
+			agent->request_stop();
+			ponder_task.get();
+		}
+	}
 
 public:
 	Game(const InitData& init) :IScene(init) {
+		trace.open(SEARCH_TRACE_FILE);
 		int cpu_type = getData().cpuType;
 		this->player_is_first = getData().player_is_first;
 		if (cpu_type == 0) {
@@ -189,40 +269,39 @@ public:
 		else if (cpu_type == 1) {
 			this->agent = std::make_unique<MonteCalroAgent>();
 		}
-		else {
+		else if (cpu_type == 2) {
 			this->agent = std::make_unique<MonteCalroTreeAgent>();
 		}
-	}
-	GameState board = GameState(
-		{
-		{-1,-1,-1,-1,-1,-1,-1,-1},
-		{-1,-1,-1,-1,-1,-1,-1,-1},
-		{-1,-1,-1,-1,-1,-1,-1,-1},
-		{-1,-1,-1,1,0,-1,-1,-1},
-		{-1,-1,-1,0,1,-1,-1,-1},
-		{-1,-1,-1,-1,-1,-1,-1,-1},
-		{-1,-1,-1,-1,-1,-1,-1,-1},
-		{-1,-1,-1,-1,-1,-1,-1,-1}
+		else {
+			this->agent = std::make_unique<AlphaBetaAgent>();
 		}
-	);
+	}
+
+	// V[𔲂Ƃ͒Tł؂ăXbh̏I҂
+	~Game() {
+		agent->request_stop();
+		if (cpu_action.valid())cpu_action.wait();
+		if (ponder_task.valid())ponder_task.wait();
+	}
+	GameState board = GameState(initial_board(getData().board_size));
 	void update() override {
 		m_passTransition.update(m_passButton.mouseOver());
 		bool is_pass = m_passButton.leftClicked();
 
 		if (player_is_first) {
 			if (is_first_turn) { // Human
-				board.update(is_pass);
+				update_human(is_pass);
 			}
 			else { // AI
-				board.update_by_cpu(*agent);
+				update_cpu();
 			}
 		}
 		else {
 			if (is_first_turn) { // AI
-				board.update_by_cpu(*agent);
+				update_cpu();
 			}
 			else { // Human
-				board.update(is_pass);
+				update_human(is_pass);
 			}
 		}
 
@@ -237,16 +316,20 @@ public:
 		}
 	}
 
+	size_t thinking_dots() const {
+		return (size_t)(Scene::Time() * 2) % 4;
+	}
+
 	void draw() const override {
 		board.draw();
 		info_area_rect.draw(Palette::Gray);
 
 		if (is_first_turn) {
-			if (!player_is_first)FontAsset(U"Info")(U"CPUvl...").drawAt(Scene::Center(), Palette::White);
+			if (!player_is_first)FontAsset(U"Info")(U"CPUvl" + String(thinking_dots(), U'.')).drawAt(Scene::Center(), Palette::White);
 			FontAsset(U"Info")(U"F{}"_fmt(this->player_is_first ? U"Ȃ" : U"CPU")).drawAt(Vec2(620, 550), Palette::Black);
 		}
 		else {
-			if (player_is_first)FontAsset(U"Info")(U"CPUvl...").drawAt(Scene::Center(), Palette::White);
+			if (player_is_first)FontAsset(U"Info")(U"CPUvl" + String(thinking_dots(), U'.')).drawAt(Scene::Center(), Palette::White);
 			FontAsset(U"Info")(U"F{}"_fmt(this->player_is_first ? U"CPU" : U"Ȃ")).drawAt(Vec2(620, 550), Palette::White);
 		}
 
@@ -254,6 +337,10 @@ public:
 		FontAsset(U"Info")(U"{}:{}"_fmt(this->player_is_first ? U"Ȃ" : U"CPU", this->player_is_first ? board.get_white_count() : board.get_black_count())).drawAt(Vec2(620, Scene::Center().movedBy(0, -250).y), this->player_is_first ? Palette::White : Palette::Black);
 		FontAsset(U"Info")(U"{}:{}"_fmt(this->player_is_first ? U"CPU" : U"Ȃ", this->player_is_first ? board.get_black_count() : board.get_white_count())).drawAt(Vec2(620, Scene::Center().movedBy(0, -200).y), this->player_is_first ? Palette::Black : Palette::White);
 
+		for (size_t i = 0; i < stats_text.size(); i++) {
+			FontAsset(U"Stats")(stats_text[i]).draw(510, 140 + 22 * i, Palette::White);
+		}
+
 		m_passButton.draw(ColorF(1.0, m_passTransition.value())).drawFrame(2);
 		FontAsset(U"Info")(U"pX").drawAt(m_passButton.center(), ColorF(0.25));
 	}
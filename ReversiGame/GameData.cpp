@@ -4,6 +4,7 @@
 struct GameData {
 	int cpuType = 0;
 	bool player_is_first = true;
+	int board_size = 8; // 6, 8, 10
 	int score = 0;
 	int black = 0, white = 0;
 	int result = 0; // Draw:0,Win:1,Lose:2
@@ -0,0 +1,297 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "Bitboard.cpp"
+#include "SimpleState.cpp"
+#include "MappedFile.cpp"
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+// 棋譜ファイル。ファイルの先頭の後に、エージェント名の定義と対局が追記された順に並ぶ
+// 対局は 16 バイトの見出しと 1 手 1 バイトの手順で、初期局面は常に標準のもの。エージェント名は最初に出てきたときに 1 度だけ書き、以後は番号で指す
+namespace record {
+	constexpr char MAGIC[4] = { 'R', 'V', 'G', 'R' };
+	constexpr uint32_t VERSION = 1;
+
+	struct FileHeader {
+		char magic[4];
+		uint32_t version;
+	};
+
+	enum : uint8_t {
+		RECORD_AGENT = 1,
+		RECORD_GAME = 2,
+	};
+
+	// 続けて length バイトの名前
+	struct AgentHeader {
+		uint8_t type;
+		uint8_t length;
+		uint16_t id;
+	};
+
+	// 続けて move_count バイトの手
+	struct GameHeader {
+		uint8_t type;
+		uint8_t move_count;
+		uint8_t black_discs;
+		uint8_t white_discs;
+		uint16_t black_agent;
+		uint16_t white_agent;
+		uint64_t seed; // 対局を作ったときの乱数の種。無ければ 0
+	};
+
+	static_assert(sizeof(AgentHeader) == 4 && sizeof(GameHeader) == 16, "record headers must not have padding");
+
+	// 手は 0..63 のマスか bitboard::PASS。探索ではなく乱択で打った手は上位ビットを立てる
+	constexpr uint8_t MOVE_MASK = 0x7f;
+	constexpr uint8_t MOVE_RANDOM = 0x80;
+
+	struct GameRecord {
+		std::string black;
+		std::string white;
+		uint64_t seed = 0;
+		int black_discs = 0;
+		int white_discs = 0;
+		std::vector<uint8_t> moves;
+	};
+}
+
+// ファイルを写したメモリから読む。開くときに見出しだけをたどって対局の位置の索引を作り、以後は何局目でも直接読める
+class RecordReader {
+public:
+	// 対局 1 つ分。手順はファイルを写したメモリを指している
+	struct Game {
+		const std::string* black;
+		const std::string* white;
+		uint64_t seed;
+		int black_discs;
+		int white_discs;
+		int move_count;
+		const uint8_t* moves;
+
+		int move(int i) const {
+			return moves[i] & record::MOVE_MASK;
+		}
+
+		bool is_random(int i) const {
+			return (moves[i] & record::MOVE_RANDOM) != 0;
+		}
+	};
+
+private:
+	MappedFile file;
+	std::vector<size_t> offsets;
+	std::vector<std::string> agents;
+	size_t valid_size; // 末尾に書きかけの記録があれば、その手前まで
+
+	const uint8_t* at(size_t offset) const {
+		return file.data() + offset;
+	}
+
+public:
+	RecordReader() :valid_size(0) {}
+
+	bool load(const std::string& path) {
+		offsets.clear();
+		agents.clear();
+		valid_size = 0;
+		if (!file.open(path))return false;
+		record::FileHeader header;
+		if (file.size() < sizeof(header)) {
+			file.close();
+			return false;
+		}
+		std::memcpy(&header, file.data(), sizeof(header));
+		if (std::memcmp(header.magic, record::MAGIC, 4) != 0 || header.version != record::VERSION) {
+			file.close();
+			return false;
+		}
+		size_t offset = sizeof(header);
+		while (offset < file.size()) {
+			uint8_t type = *at(offset);
+			if (type == record::RECORD_AGENT) {
+				record::AgentHeader agent;
+				if (offset + sizeof(agent) > file.size())break;
+				std::memcpy(&agent, at(offset), sizeof(agent));
+				size_t end = offset + sizeof(agent) + agent.length;
+				if (end > file.size())break;
+				if (agents.size() <= agent.id)agents.resize(agent.id + 1);
+				agents[agent.id].assign((const char*)at(offset + sizeof(agent)), agent.length);
+				offset = end;
+			}
+			else if (type == record::RECORD_GAME) {
+				record::GameHeader game;
+				if (offset + sizeof(game) > file.size())break;
+				std::memcpy(&game, at(offset), sizeof(game));
+				size_t end = offset + sizeof(game) + game.move_count;
+				if (end > file.size() || game.black_agent >= agents.size() || game.white_agent >= agents.size())break;
+				offsets.push_back(offset);
+				offset = end;
+			}
+			else {
+				break;
+			}
+		}
+		valid_size = offset;
+		return true;
+	}
+
+	size_t size() const {
+		return this->offsets.size();
+	}
+
+	// 壊れていない部分の長さ。ファイルの長さより短ければ末尾が書きかけ
+	size_t get_valid_size() const {
+		return this->valid_size;
+	}
+
+	const std::vector<std::string>& get_agents() const {
+		return this->agents;
+	}
+
+	Game game(size_t index) const {
+		record::GameHeader header;
+		std::memcpy(&header, at(offsets[index]), sizeof(header));
+		return { &agents[header.black_agent], &agents[header.white_agent], header.seed, header.black_discs, header.white_discs,
+			header.move_count, at(offsets[index] + sizeof(header)) };
+	}
+
+	// 初期局面から打ち直し、各手を打つ前の局面と手を順に f(state, move, random) へ渡す。途中に非合法手があれば false
+	template <class F>
+	bool replay(size_t index, F&& f) const {
+		Game g = game(index);
+		SimpleState state(bitboard::INITIAL_PLAYER, bitboard::INITIAL_OPPONENT, 0);
+		for (int i = 0; i < g.move_count; i++) {
+			int pos = g.move(i);
+			if (state.is_done())return false;
+			uint64_t legal = state.legal_moves();
+			if (pos == bitboard::PASS ? legal != 0 : (pos > bitboard::PASS || !(legal & bitboard::bit(pos))))return false;
+			f(state, pos, g.is_random(i));
+			state.make_move(pos);
+		}
+		if (!state.is_done())return false;
+		auto [mine, theirs] = state.stone_count();
+		int black = state.teban() == 0 ? mine : theirs;
+		return black == g.black_discs && bitboard::CELLS - state.empty_count() - black == g.white_discs;
+	}
+};
+
+// 追記だけで書き足していく。既存のファイルに足すときは、エージェント名の番号を引き継ぎ、書きかけの末尾を切り捨ててから書く
+// write は複数スレッドから呼んでよい
+class RecordWriter {
+private:
+	std::FILE* file;
+	std::mutex mutex;
+	std::unordered_map<std::string, uint16_t> agent_ids;
+
+	uint16_t agent_id(const std::string& name) {
+		auto it = agent_ids.find(name);
+		if (it != agent_ids.end())return it->second;
+		uint16_t id = (uint16_t)agent_ids.size();
+		std::string stored = name.substr(0, 255);
+		record::AgentHeader header = { record::RECORD_AGENT, (uint8_t)stored.size(), id };
+		std::fwrite(&header, sizeof(header), 1, file);
+		std::fwrite(stored.data(), 1, stored.size(), file);
+		agent_ids.emplace(name, id);
+		return id;
+	}
+
+public:
+	RecordWriter() :file(nullptr) {}
+	RecordWriter(const RecordWriter&) = delete;
+	RecordWriter& operator=(const RecordWriter&) = delete;
+	~RecordWriter() {
+		close();
+	}
+
+	bool open(const std::string& path) {
+		close();
+		agent_ids.clear();
+		std::error_code error;
+		uintmax_t size = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+		if (error)return false;
+		if (size > 0) {
+			size_t valid_size;
+			{
+				RecordReader reader;
+				if (!reader.load(path))return false;
+				for (size_t i = 0; i < reader.get_agents().size(); i++)agent_ids.emplace(reader.get_agents()[i], (uint16_t)i);
+				valid_size = reader.get_valid_size();
+			}
+			if (valid_size < size) {
+				std::filesystem::resize_file(path, valid_size, error);
+				if (error)return false;
+			}
+		}
+		file = std::fopen(path.c_str(), "ab");
+		if (!file)return false;
+		if (size == 0) {
+			record::FileHeader header = { { record::MAGIC[0], record::MAGIC[1], record::MAGIC[2], record::MAGIC[3] }, record::VERSION };
+			std::fwrite(&header, sizeof(header), 1, file);
+		}
+		return true;
+	}
+
+	void close() {
+		if (file)std::fclose(file);
+		this->file = nullptr;
+	}
+
+	bool is_open() const {
+		return this->file != nullptr;
+	}
+
+	bool write(const record::GameRecord& game) {
+		if (!file || game.moves.size() > 255)return false;
+		std::lock_guard<std::mutex> lock(mutex);
+		record::GameHeader header = { record::RECORD_GAME, (uint8_t)game.moves.size(), (uint8_t)game.black_discs, (uint8_t)game.white_discs,
+			agent_id(game.black), agent_id(game.white), game.seed };
+		std::fwrite(&header, sizeof(header), 1, file);
+		std::fwrite(game.moves.data(), 1, game.moves.size(), file);
+		return !std::ferror(file);
+	}
+
+	// 溜まっている分を書き出す。途中で止まっても、書き出した所までは読める
+	void flush() {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (file)std::fflush(file);
+	}
+};
+
+namespace record {
+	// 学習に使う局面。result は手番側から見た終局の石差
+	struct Position {
+		size_t game;
+		uint64_t player;
+		uint64_t opponent;
+		uint64_t legal;
+		int move;
+		bool random;
+		int result;
+	};
+
+	// 棋譜の局面を 1 局ずつ打ち直して f(position) へ渡す。ファイル全体を展開せず、1 局分の局面だけを持つ
+	// パスの局面は渡さない。打ち直せない対局は飛ばし、その数を返す
+	template <class F>
+	inline size_t for_each_position(const RecordReader& reader, F&& f) {
+		size_t skipped = 0;
+		std::vector<Position> positions;
+		for (size_t i = 0; i < reader.size(); i++) {
+			positions.clear();
+			RecordReader::Game g = reader.game(i);
+			bool ok = reader.replay(i, [&](const SimpleState& state, int pos, bool random) {
+				if (pos == bitboard::PASS)return;
+				int diff = g.black_discs - g.white_discs;
+				positions.push_back({ i, state.get_player(), state.get_opponent(), state.legal_moves(), pos, random, state.teban() == 0 ? diff : -diff });
+			});
+			if (!ok) {
+				skipped++;
+				continue;
+			}
+			for (const Position& position : positions)f(position);
+		}
+		return skipped;
+	}
+}
\ No newline at end of file
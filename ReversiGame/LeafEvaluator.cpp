@@ -0,0 +1,40 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "SimpleState.cpp"
+#include "Playout.cpp"
+#include "PatternEvaluator.cpp"
+
+// MCTS が集めた葉をまとめて評価する。探索スレッドごとに 1 回ずつ呼ばれるので、evaluate は複数のスレッドから同時に呼ばれてよいこと
+class LeafEvaluator {
+public:
+	virtual ~LeafEvaluator() {}
+
+	// 終局していない states[i] の手番側から見た 勝ち 1 / 引き分け 0 / 負け -1 を values[i] に書く。engine はそのスレッドの乱数とプレイアウト数
+	// played があれば、評価の途中で states[i] の手番側が打ったマスを played[2i] に、相手が打ったマスを played[2i + 1] に書く (RAVE で使う)
+	virtual void evaluate(const SimpleState* states, int count, int* values, PlayoutEngine& engine, uint64_t* played) const = 0;
+};
+
+// 1 局面につき 1 回プレイアウトを打つ
+class PlayoutLeafEvaluator :public LeafEvaluator {
+public:
+	void evaluate(const SimpleState* states, int count, int* values, PlayoutEngine& engine, uint64_t* played) const {
+		for (int i = 0; i < count; i++)values[i] = engine.run(states[i], played ? played + 2 * i : nullptr);
+	}
+};
+
+// プレイアウトをせず、パターン評価の符号をそのまま使う
+class PatternLeafEvaluator :public LeafEvaluator {
+private:
+	const PatternEvaluator* patterns;
+
+public:
+	explicit PatternLeafEvaluator(const PatternEvaluator* patterns) :patterns(patterns) {}
+
+	void evaluate(const SimpleState* states, int count, int* values, PlayoutEngine&, uint64_t* played) const {
+		if (played)std::fill(played, played + 2 * count, 0);
+		for (int i = 0; i < count; i++) {
+			int score = patterns->evaluate(states[i].get_player(), states[i].get_opponent());
+			values[i] = (score > 0) - (score < 0);
+		}
+	}
+};
\ No newline at end of file
@@ -13,6 +13,7 @@ void Main()
 	FontAsset::Register(U"Info", 36, Typeface::Bold);
 	FontAsset::Register(U"Result", 60, Typeface::Bold);
 	FontAsset::Register(U"ResultSmall", 36, Typeface::Bold);
+	FontAsset::Register(U"Stats", 16, Typeface::Regular);
 
 
 	// 背景色を設定
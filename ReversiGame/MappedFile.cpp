@@ -0,0 +1,86 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#ifdef _WIN32
+// <windows.h> のマクロがエンジン全体に漏れないよう、Win32 の呼び出しは MappedFileWin32.cpp に置く。ハンドルは void* で持つ
+namespace mapped_file {
+	bool map_win32(const std::string& path, void*& file, void*& mapping, const uint8_t*& ptr, size_t& length);
+	void unmap_win32(void* file, void* mapping, const uint8_t* ptr);
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 読み込み専用でファイルをメモリに写す。同じファイルを開いたプロセス同士はページキャッシュの 1 つの写しを共有する
+class MappedFile {
+private:
+	const uint8_t* ptr;
+	size_t length;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#endif
+
+public:
+	MappedFile() :ptr(nullptr), length(0)
+#ifdef _WIN32
+		, file(nullptr), mapping(nullptr)
+#endif
+	{}
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile() {
+		close();
+	}
+
+	bool open(const std::string& path) {
+		close();
+#ifdef _WIN32
+		if (!mapped_file::map_win32(path, file, mapping, ptr, length)) {
+			close();
+			return false;
+		}
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (p == MAP_FAILED)return false;
+		ptr = (const uint8_t*)p;
+		length = (size_t)st.st_size;
+#endif
+		return true;
+	}
+
+	void close() {
+#ifdef _WIN32
+		mapped_file::unmap_win32(file, mapping, ptr);
+		mapping = nullptr;
+		file = nullptr;
+#else
+		if (ptr)munmap((void*)ptr, length);
+#endif
+		ptr = nullptr;
+		length = 0;
+	}
+
+	bool is_open() const {
+		return this->ptr != nullptr;
+	}
+
+	const uint8_t* data() const {
+		return this->ptr;
+	}
+
+	size_t size() const {
+		return this->length;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,50 @@
+﻿// MappedFile の Win32 部分。<windows.h> はこの翻訳単位の中だけで読む
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <cstdint>
+#include <string>
+
+namespace mapped_file {
+	// 失敗したときは開いたハンドルを閉じ、すべて nullptr のまま返す
+	bool map_win32(const std::string& path, void*& file, void*& mapping, const uint8_t*& ptr, size_t& length) {
+		file = mapping = nullptr;
+		ptr = nullptr;
+		length = 0;
+		HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (f == INVALID_HANDLE_VALUE)return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(f, &size) || size.QuadPart == 0) {
+			CloseHandle(f);
+			return false;
+		}
+		HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m) {
+			CloseHandle(f);
+			return false;
+		}
+		const uint8_t* p = (const uint8_t*)MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+		if (!p) {
+			CloseHandle(m);
+			CloseHandle(f);
+			return false;
+		}
+		file = f;
+		mapping = m;
+		ptr = p;
+		length = (size_t)size.QuadPart;
+		return true;
+	}
+
+	void unmap_win32(void* file, void* mapping, const uint8_t* ptr) {
+		if (ptr)UnmapViewOfFile(ptr);
+		if (mapping)CloseHandle(mapping);
+		if (file)CloseHandle(file);
+	}
+}
+#endif
\ No newline at end of file
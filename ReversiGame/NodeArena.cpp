@@ -0,0 +1,203 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "Bitboard.cpp"
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+// 木のノード。局面は持たず、親からの手だけを持つ
+// w, n は複数スレッドから更新されるので atomic。子の情報は expand_state を EXPANDED にしてから公開する
+struct TreeNode {
+	enum : uint8_t { LEAF, EXPANDING, EXPANDED };
+
+	std::atomic<int32_t> w;
+	std::atomic<int32_t> n;
+	std::atomic<int32_t> amaf_w; // RAVE の統計。親の局面以降のどこかでこの手が打たれた探索の結果
+	std::atomic<int32_t> amaf_n;
+	uint64_t hash; // 置換表を引くための局面のハッシュ
+	uint32_t first_child;
+	uint8_t child_count;
+	uint8_t move;
+	uint8_t prior; // PUCT で使う方策の確率。255 で 1
+	std::atomic<uint8_t> expand_state;
+
+	TreeNode() :w(0), n(0), amaf_w(0), amaf_n(0), hash(0), first_child(0), child_count(0), move(0), prior(0), expand_state(LEAF) {}
+	TreeNode(const TreeNode& other) {
+		*this = other;
+	}
+
+	TreeNode& operator=(const TreeNode& other) {
+		w.store(other.w.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		n.store(other.n.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		amaf_w.store(other.amaf_w.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		amaf_n.store(other.amaf_n.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		hash = other.hash;
+		first_child = other.first_child;
+		child_count = other.child_count;
+		move = other.move;
+		prior = other.prior;
+		expand_state.store(other.expand_state.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		return *this;
+	}
+
+	bool is_expanded() const {
+		return expand_state.load(std::memory_order_acquire) == EXPANDED;
+	}
+};
+
+// ノードを連続領域に確保し、子は first_child から child_count 個並べる
+// 探索中に領域を動かさないよう容量分のアドレスは最初に取っておき、ノードは使う所まで少しずつ作る (触らないページは実メモリを食わない)
+// 容量を使い切ったら allocate は INVALID を返す
+class NodeArena {
+private:
+	static const uint32_t MIN_GROWTH = 1 << 12;
+
+	TreeNode* nodes;
+	uint32_t node_capacity;
+	std::atomic<uint32_t> used;
+	std::atomic<uint32_t> committed; // ここまでのノードは作ってある
+	std::mutex grow_mutex;
+
+	void release() {
+		if (nodes)std::allocator<TreeNode>().deallocate(nodes, node_capacity);
+		this->nodes = nullptr;
+		this->node_capacity = 0;
+		this->committed.store(0, std::memory_order_relaxed);
+	}
+
+	// end までのノードを作る。足りなくなるたびに倍に広げる
+	void commit(uint32_t end) {
+		std::lock_guard<std::mutex> lock(grow_mutex);
+		uint32_t current = committed.load(std::memory_order_relaxed);
+		if (end <= current)return;
+		uint32_t target = (uint32_t)std::min<uint64_t>(node_capacity, std::max<uint64_t>({ end, (uint64_t)current * 2, MIN_GROWTH }));
+		for (uint32_t i = current; i < target; i++)new (&nodes[i]) TreeNode();
+		committed.store(target, std::memory_order_release);
+	}
+
+public:
+	static const uint32_t INVALID = UINT32_MAX;
+
+	explicit NodeArena(uint32_t capacity = 0) :nodes(nullptr), node_capacity(0), used(0), committed(0) {
+		set_capacity(capacity);
+	}
+	NodeArena(const NodeArena&) = delete;
+	NodeArena& operator=(const NodeArena&) = delete;
+	~NodeArena() {
+		release();
+	}
+
+	void set_capacity(uint32_t capacity) {
+		if (this->node_capacity != capacity) {
+			release();
+			if (capacity > 0)this->nodes = std::allocator<TreeNode>().allocate(capacity);
+			this->node_capacity = capacity;
+		}
+		reset();
+	}
+
+	uint32_t capacity() const {
+		return this->node_capacity;
+	}
+
+	// 確保済みの領域はそのまま使い回すので O(1)
+	void reset() {
+		this->used.store(0, std::memory_order_relaxed);
+	}
+
+	// 複数スレッドから同時に呼んでよい
+	uint32_t allocate(int count) {
+		uint32_t index = this->used.fetch_add(count, std::memory_order_relaxed);
+		if ((uint64_t)index + count > node_capacity) {
+			return INVALID;
+		}
+		if (index + count > committed.load(std::memory_order_acquire))commit(index + count);
+		return index;
+	}
+
+	TreeNode& operator[](uint32_t index) {
+		return this->nodes[index];
+	}
+
+	const TreeNode& operator[](uint32_t index) const {
+		return this->nodes[index];
+	}
+
+	// 1 度でも確保に失敗したか、ちょうど使い切った
+	bool full() const {
+		return this->used.load(std::memory_order_relaxed) >= capacity();
+	}
+
+	// src の src_root 以下をこのアリーナへ幅優先で詰めて写す。新しい根は 0 番
+	// 訪問回数が min_visits に満たないノードは子を写さずに葉へ戻し、自分の w, n だけを残す
+	void copy_subtree(const NodeArena& src, uint32_t src_root, int min_visits = 0) {
+		if (capacity() < src.capacity()) {
+			set_capacity(src.capacity());
+		}
+		reset();
+		allocate(1);
+		this->nodes[0] = src[src_root];
+		for (uint32_t i = 0; i < size(); i++) {
+			int count = this->nodes[i].child_count;
+			if (count == 0)continue;
+			if (i > 0 && this->nodes[i].n.load(std::memory_order_relaxed) < min_visits) {
+				this->nodes[i].child_count = 0;
+				this->nodes[i].first_child = 0;
+				this->nodes[i].expand_state.store(TreeNode::LEAF, std::memory_order_relaxed);
+				continue;
+			}
+			uint32_t src_first = this->nodes[i].first_child;
+			uint32_t first = allocate(count);
+			for (int j = 0; j < count; j++) {
+				TreeNode& node = this->nodes[first + j];
+				node = src[src_first + j];
+				// 容量不足で展開できなかったノードは、詰めた後にもう一度展開できるようにする
+				if (node.expand_state.load(std::memory_order_relaxed) == TreeNode::EXPANDING) {
+					node.expand_state.store(TreeNode::LEAF, std::memory_order_relaxed);
+				}
+			}
+			this->nodes[i].first_child = first;
+		}
+	}
+
+	// copy_subtree(*this, root, min_visits) の結果が budget 個に収まる最小の min_visits
+	// 子の訪問回数は親以下なので、訪問の多い順に子を持たせていけば根から繋がった木になる
+	int min_visits_to_fit(uint32_t root, uint32_t budget) const {
+		std::vector<std::pair<int, int>> expanded; // 訪問回数と子の数
+		std::vector<uint32_t> stack = { root };
+		while (!stack.empty()) {
+			const TreeNode& node = this->nodes[stack.back()];
+			stack.pop_back();
+			if (node.child_count == 0)continue;
+			expanded.emplace_back(node.n.load(std::memory_order_relaxed), node.child_count);
+			for (uint32_t i = node.first_child; i < node.first_child + node.child_count; i++)stack.push_back(i);
+		}
+		std::sort(expanded.begin(), expanded.end(), std::greater<>());
+		uint64_t kept = 1;
+		for (auto& [n, count] : expanded) {
+			kept += count;
+			if (kept > budget)return n + 1;
+		}
+		return 0;
+	}
+
+	void swap(NodeArena& other) {
+		std::swap(this->nodes, other.nodes);
+		std::swap(this->node_capacity, other.node_capacity);
+		uint32_t committed_tmp = this->committed.load(std::memory_order_relaxed);
+		this->committed.store(other.committed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		other.committed.store(committed_tmp, std::memory_order_relaxed);
+		uint32_t tmp = this->used.load(std::memory_order_relaxed);
+		this->used.store(other.used.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		other.used.store(tmp, std::memory_order_relaxed);
+	}
+
+	uint32_t size() const {
+		return std::min<uint32_t>(this->used.load(std::memory_order_relaxed), capacity());
+	}
+
+	// 作ったノードの分。容量分のアドレスのうち、実際にメモリを使っている所
+	size_t memory_usage() const {
+		return (size_t)this->committed.load(std::memory_order_relaxed) * sizeof(TreeNode);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,133 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "Bitboard.cpp"
+#include "MappedFile.cpp"
+#include "SharedFile.cpp"
+#include <fstream>
+
+// 序盤の定跡。盤の対称形を 1 つにまとめた局面ごとに、打った手とその後の勝敗を持つ
+namespace book {
+	// 対称形のうち (player, opponent) が最小のものを代表にする
+	struct Canonical {
+		uint64_t player;
+		uint64_t opponent;
+		int symmetry; // 元の盤からこの変換で代表に移る
+	};
+
+	inline Canonical canonical(uint64_t p, uint64_t o) {
+		Canonical best = { p, o, 0 };
+		for (int s = 1; s < bitboard::SYMMETRY_COUNT; s++) {
+			uint64_t sp = bitboard::symmetry(p, s), so = bitboard::symmetry(o, s);
+			if (sp < best.player || (sp == best.player && so < best.opponent))best = { sp, so, s };
+		}
+		return best;
+	}
+
+	// 下位 7bit は手を入れるので空けておく
+	constexpr uint64_t MOVE_BITS = 0x7f;
+
+	inline uint64_t position_key(const Canonical& c) {
+		uint64_t h = c.player * 0x9e3779b97f4a7c15ULL ^ c.opponent;
+		h = (h ^ (h >> 31)) * 0xbf58476d1ce4e5b9ULL;
+		h = (h ^ (h >> 29)) * 0x94d049bb133111ebULL;
+		return (h ^ (h >> 32)) & ~MOVE_BITS;
+	}
+
+	// key の順に並べる。同じ局面の手は key の上位が同じなので隣り合う
+	struct Entry {
+		uint64_t key;    // 局面のキー | 代表の向きでの手
+		uint32_t games;
+		uint32_t points; // 手を打った側から見て 勝ち 2、引き分け 1、負け 0 の合計
+	};
+
+	struct FileHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t entry_count;
+	};
+
+	constexpr char MAGIC[4] = { 'R', 'V', 'B', 'K' };
+	constexpr uint32_t VERSION = 1;
+
+	// entries は key の順に並んでいること
+	inline bool write_file(const std::string& path, const std::vector<Entry>& entries) {
+		FileHeader header = { { MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3] }, VERSION, entries.size() };
+		std::ofstream out(path, std::ios::binary);
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)entries.data(), entries.size() * sizeof(Entry));
+		return (bool)out;
+	}
+}
+
+// ファイルを写したメモリを二分探索するので、読み込み時の変換はない
+class OpeningBook {
+private:
+	MappedFile file;
+	const book::Entry* entries;
+	size_t entry_count;
+
+public:
+	OpeningBook() :entries(nullptr), entry_count(0) {}
+
+	bool load(const std::string& path) {
+		entries = nullptr;
+		entry_count = 0;
+		if (!file.open(path))return false;
+		const book::FileHeader* header = (const book::FileHeader*)file.data();
+		if (file.size() < sizeof(book::FileHeader) || std::memcmp(header->magic, book::MAGIC, 4) != 0 || header->version != book::VERSION
+			|| file.size() != sizeof(book::FileHeader) + header->entry_count * sizeof(book::Entry)) {
+			file.close();
+			return false;
+		}
+		entries = (const book::Entry*)(file.data() + sizeof(book::FileHeader));
+		entry_count = header->entry_count;
+		return true;
+	}
+
+	size_t size() const {
+		return this->entry_count;
+	}
+
+	const book::Entry* begin() const {
+		return this->entries;
+	}
+
+	const book::Entry* end() const {
+		return this->entries + this->entry_count;
+	}
+
+	// 手番側 p の局面で定跡にある手を返す。min_games 局以上打たれた手のうち、勝率の下側の見積もりが最もよいもの。無ければ -1
+	int probe(uint64_t p, uint64_t o, int min_games = BOOK_MIN_GAMES) const {
+		book::Canonical c = book::canonical(p, o);
+		uint64_t key = book::position_key(c);
+		const book::Entry* it = std::lower_bound(begin(), end(), key, [](const book::Entry& e, uint64_t k) {
+			return e.key < k;
+		});
+		uint64_t legal = bitboard::legal_moves(p, o);
+		int best = -1;
+		double best_rate = -INFINITY;
+		for (; it != end() && (it->key & ~book::MOVE_BITS) == key; it++) {
+			if (it->games < (uint32_t)min_games)continue;
+			// 別の局面とキーが重なっていても合法手しか返さない
+			uint64_t move = bitboard::inverse_symmetry(bitboard::bit((int)(it->key & book::MOVE_BITS)), c.symmetry);
+			if (!(legal & move))continue;
+			// 局数の少ない手がたまたま勝っただけで選ばれないように、勝率から標準誤差の分を引く
+			double rate = it->points / (2.0 * it->games) - 0.5 / std::sqrt((double)it->games);
+			if (rate > best_rate) {
+				best_rate = rate;
+				best = bitboard::lsb(move);
+			}
+		}
+		return best;
+	}
+
+	// プロセスで共有する定跡を path に決めて返す。空なら使わない。読めないか、既に別のファイルに決まっていれば nullptr
+	static const OpeningBook* shared(const std::string& path) {
+		return SharedFile<OpeningBook>::load(path);
+	}
+
+	// 共有している定跡。まだ決まっていなければ OPENING_BOOK_FILE を読む
+	static const OpeningBook* shared() {
+		return SharedFile<OpeningBook>::get(OPENING_BOOK_FILE);
+	}
+};
\ No newline at end of file
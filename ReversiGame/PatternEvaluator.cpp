@@ -0,0 +1,206 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "Bitboard.cpp"
+#include "MappedFile.cpp"
+#include "SharedFile.cpp"
+#include <fstream>
+
+// 辺・隅・斜めの n-tuple パターンによる評価関数
+// 各パターンはマスを 3 進数の桁 (空き 0、手番側 1、相手 2) とみなした番号で重みを引き、盤の対称形どうしで重みを共有する
+namespace pattern {
+	constexpr int MAX_CELLS = 10;
+	constexpr int MAX_INSTANCES = 8;
+	constexpr int GROUP_COUNT = 11;
+	constexpr int STAGE_COUNT = 6; // 石の数で 6 段階に分けて別の重みを使う
+
+	struct Shape {
+		int cells;
+		uint8_t squares[MAX_CELLS];
+	};
+
+	// 左上を基準にした形。残りは対称変換で作る
+	constexpr Shape BASE_SHAPES[GROUP_COUNT] = {
+		{ 8, { 8, 9, 10, 11, 12, 13, 14, 15 } },         // 2 段目
+		{ 8, { 16, 17, 18, 19, 20, 21, 22, 23 } },       // 3 段目
+		{ 8, { 24, 25, 26, 27, 28, 29, 30, 31 } },       // 4 段目
+		{ 4, { 3, 10, 17, 24 } },                        // 長さ 4 の斜め
+		{ 5, { 4, 11, 18, 25, 32 } },
+		{ 6, { 5, 12, 19, 26, 33, 40 } },
+		{ 7, { 6, 13, 20, 27, 34, 41, 48 } },
+		{ 8, { 0, 9, 18, 27, 36, 45, 54, 63 } },         // 対角線
+		{ 10, { 0, 1, 2, 3, 4, 5, 6, 7, 9, 14 } },       // 辺と X 打ちの 2 マス
+		{ 9, { 0, 1, 2, 8, 9, 10, 16, 17, 18 } },        // 隅の 3x3
+		{ 10, { 0, 1, 2, 3, 4, 8, 9, 10, 11, 12 } },     // 隅の 2x5
+	};
+
+	struct Group {
+		int cells;
+		int instance_count;
+		int offset; // 1 段階分の重みの中での先頭
+		uint8_t squares[MAX_INSTANCES][MAX_CELLS];
+	};
+
+	struct Layout {
+		Group groups[GROUP_COUNT];
+		int instance_count;
+		int weight_count; // 1 段階あたり
+	};
+
+	constexpr int pow3(int n) {
+		int r = 1;
+		for (int i = 0; i < n; i++)r *= 3;
+		return r;
+	}
+
+	// 左右反転・上下反転・転置の組み合わせで 8 通り
+	constexpr int transform(int pos, int symmetry) {
+		int x = pos % bitboard::SIZE, y = pos / bitboard::SIZE;
+		if (symmetry & 1)x = bitboard::SIZE - 1 - x;
+		if (symmetry & 2)y = bitboard::SIZE - 1 - y;
+		if (symmetry & 4) {
+			int t = x;
+			x = y;
+			y = t;
+		}
+		return y * bitboard::SIZE + x;
+	}
+
+	// マスの並びまで同じになる変換だけを省く。集合が同じでも並びが違えば別に数えないと、対称な局面で評価値が変わる
+	constexpr Layout make_layout() {
+		Layout layout = {};
+		int offset = 0;
+		for (int g = 0; g < GROUP_COUNT; g++) {
+			const Shape& shape = BASE_SHAPES[g];
+			Group& group = layout.groups[g];
+			group.cells = shape.cells;
+			group.offset = offset;
+			for (int symmetry = 0; symmetry < 8; symmetry++) {
+				uint8_t squares[MAX_CELLS] = {};
+				for (int i = 0; i < shape.cells; i++)squares[i] = (uint8_t)transform(shape.squares[i], symmetry);
+				bool duplicate = false;
+				for (int k = 0; k < group.instance_count; k++) {
+					bool same = true;
+					for (int i = 0; i < shape.cells; i++)same &= group.squares[k][i] == squares[i];
+					duplicate |= same;
+				}
+				if (duplicate)continue;
+				for (int i = 0; i < shape.cells; i++)group.squares[group.instance_count][i] = squares[i];
+				group.instance_count++;
+			}
+			layout.instance_count += group.instance_count;
+			offset += pow3(shape.cells);
+		}
+		layout.weight_count = offset;
+		return layout;
+	}
+
+	inline constexpr Layout LAYOUT = make_layout();
+
+	// 2 進数で並べたビットを同じ並びの 3 進数に直す表
+	struct Base3Table {
+		uint16_t value[1 << MAX_CELLS];
+	};
+
+	constexpr Base3Table make_base3() {
+		Base3Table table = {};
+		for (int b = 0; b < (1 << MAX_CELLS); b++) {
+			int v = 0;
+			for (int i = MAX_CELLS - 1; i >= 0; i--)v = v * 3 + ((b >> i) & 1);
+			table.value[b] = (uint16_t)v;
+		}
+		return table;
+	}
+
+	inline constexpr Base3Table BASE3 = make_base3();
+
+	inline int stage(uint64_t p, uint64_t o) {
+		return (bitboard::popcount(p | o) - 4) * STAGE_COUNT / (bitboard::CELLS - 3);
+	}
+
+	// 全パターンの重みの番号 (1 段階分の中での位置) を indices に書き、個数を返す
+	inline int feature_indices(uint64_t p, uint64_t o, int* indices) {
+		int count = 0;
+		for (const Group& group : LAYOUT.groups) {
+			for (int k = 0; k < group.instance_count; k++) {
+				const uint8_t* squares = group.squares[k];
+				uint32_t pb = 0, ob = 0;
+				for (int i = 0; i < group.cells; i++) {
+					pb |= (uint32_t)((p >> squares[i]) & 1) << i;
+					ob |= (uint32_t)((o >> squares[i]) & 1) << i;
+				}
+				indices[count++] = group.offset + BASE3.value[pb] + 2 * BASE3.value[ob];
+			}
+		}
+		return count;
+	}
+
+	// 重みファイルの先頭。続けて int16 の重みが [段階][番号] の順に並ぶ (リトルエンディアン)
+	struct FileHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t stage_count;
+		uint32_t weight_count;
+		int32_t scale; // 石 1 個の差に当たる重みの値
+	};
+
+	constexpr char MAGIC[4] = { 'R', 'V', 'P', 'T' };
+	constexpr uint32_t VERSION = 1;
+	constexpr int SCALE = 64;
+
+	inline bool write_file(const std::string& path, const std::vector<int16_t>& weights) {
+		if (weights.size() != (size_t)STAGE_COUNT * LAYOUT.weight_count)return false;
+		FileHeader header = { { MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3] }, VERSION, STAGE_COUNT, (uint32_t)LAYOUT.weight_count, SCALE };
+		std::ofstream out(path, std::ios::binary);
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)weights.data(), weights.size() * sizeof(int16_t));
+		return (bool)out;
+	}
+}
+
+// 重みはファイルを写したメモリから直接読むので、読み込みは一瞬で、複数のプロセスで 1 つの写しを共有する
+class PatternEvaluator {
+private:
+	MappedFile file;
+	const int16_t* weights;
+
+public:
+	PatternEvaluator() :weights(nullptr) {}
+
+	bool load(const std::string& path) {
+		weights = nullptr;
+		if (!file.open(path))return false;
+		const size_t expected = sizeof(pattern::FileHeader) + (size_t)pattern::STAGE_COUNT * pattern::LAYOUT.weight_count * sizeof(int16_t);
+		const pattern::FileHeader* header = (const pattern::FileHeader*)file.data();
+		if (file.size() != expected || std::memcmp(header->magic, pattern::MAGIC, 4) != 0 || header->version != pattern::VERSION
+			|| header->stage_count != pattern::STAGE_COUNT || header->weight_count != (uint32_t)pattern::LAYOUT.weight_count || header->scale != pattern::SCALE) {
+			file.close();
+			return false;
+		}
+		weights = (const int16_t*)(file.data() + sizeof(pattern::FileHeader));
+		return true;
+	}
+
+	bool is_loaded() const {
+		return this->weights != nullptr;
+	}
+
+	// 手番側 p から見た石差の予測。pattern::SCALE 倍の値を返す
+	int evaluate(uint64_t p, uint64_t o) const {
+		int indices[pattern::LAYOUT.instance_count];
+		int count = pattern::feature_indices(p, o, indices);
+		const int16_t* w = weights + (size_t)pattern::stage(p, o) * pattern::LAYOUT.weight_count;
+		int score = 0;
+		for (int i = 0; i < count; i++)score += w[indices[i]];
+		return score;
+	}
+
+	// プロセスで共有する重みを path に決めて返す。読めないか、既に別のファイルに決まっていれば nullptr
+	static const PatternEvaluator* shared(const std::string& path) {
+		return SharedFile<PatternEvaluator>::load(path);
+	}
+
+	// 共有している重み。まだ決まっていなければ PATTERN_WEIGHT_FILE を読む
+	static const PatternEvaluator* shared() {
+		return SharedFile<PatternEvaluator>::get(PATTERN_WEIGHT_FILE);
+	}
+};
\ No newline at end of file
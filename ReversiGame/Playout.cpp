@@ -0,0 +1,159 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "Bitboard.cpp"
+#include "SimpleState.cpp"
+#include "PatternEvaluator.cpp"
+
+// xoshiro256** (std::uniform_random_bit_generator としても使える)
+class Xoshiro256 {
+private:
+	uint64_t s[4];
+
+	static uint64_t rotl(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+
+public:
+	using result_type = uint64_t;
+
+	explicit Xoshiro256(uint64_t seed = 0x9e3779b97f4a7c15ULL) {
+		// splitmix64 で内部状態を埋める
+		for (auto& x : s) {
+			seed += 0x9e3779b97f4a7c15ULL;
+			uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			x = z ^ (z >> 31);
+		}
+	}
+
+	static constexpr uint64_t min() {
+		return 0;
+	}
+
+	static constexpr uint64_t max() {
+		return ~0ULL;
+	}
+
+	uint64_t operator()() {
+		uint64_t result = rotl(s[1] * 5, 7) * 9;
+		uint64_t t = s[1] << 17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return result;
+	}
+
+	// 2^128 回分進める。同じシードから jump した列どうしは重ならない
+	void jump() {
+		static const uint64_t JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+		uint64_t t[4] = { 0, 0, 0, 0 };
+		for (uint64_t jump : JUMP) {
+			for (int b = 0; b < 64; b++) {
+				if (jump & (1ULL << b)) {
+					for (int i = 0; i < 4; i++) {
+						t[i] ^= s[i];
+					}
+				}
+				(*this)();
+			}
+		}
+		for (int i = 0; i < 4; i++) {
+			s[i] = t[i];
+		}
+	}
+
+	// [0, n) の一様乱数
+	uint32_t bounded(uint32_t n) {
+		return (uint32_t)(((*this)() >> 32) * n >> 32);
+	}
+};
+
+// 合法手マスクから直接ランダムに手を選んで終局まで打つ。ヒープ確保なし
+class PlayoutEngine {
+private:
+	Xoshiro256 rng;
+	uint64_t playout_count;
+	const PatternEvaluator* evaluator;
+	int cutoff;
+
+	static uint64_t select_bit(uint64_t moves, uint32_t k) {
+		for (; k; k--) {
+			moves &= moves - 1;
+		}
+		return moves & (0 - moves);
+	}
+
+	// played を書くかどうかで分けておき、書かないときは元の速さのままにする
+	template <bool RECORD>
+	int run_impl(const SimpleState& state, uint64_t* played) {
+		playout_count++;
+		uint64_t p = state.get_player(), o = state.get_opponent();
+		uint64_t p_moves = 0, o_moves = 0;
+		int sign = 1;
+		auto finish = [&](int result) {
+			if constexpr (RECORD) {
+				played[0] = sign > 0 ? p_moves : o_moves;
+				played[1] = sign > 0 ? o_moves : p_moves;
+			}
+			return result;
+		};
+		if (!state.is_done()) {
+			bool passed = false;
+			int plies_left = evaluator ? cutoff : INT_MAX;
+			while ((p | o) != ~0ULL) {
+				if (plies_left-- == 0) {
+					int score = evaluator->evaluate(p, o);
+					return finish(sign * ((score > 0) - (score < 0)));
+				}
+				uint64_t moves = bitboard::legal_moves(p, o);
+				if (moves) {
+					uint64_t move = select_bit(moves, rng.bounded(bitboard::popcount(moves)));
+					uint64_t f = bitboard::flips(p, o, move);
+					p |= move | f;
+					o &= ~f;
+					if constexpr (RECORD)p_moves |= move;
+					passed = false;
+				}
+				else if (passed) {
+					break;
+				}
+				else {
+					passed = true;
+				}
+				std::swap(p, o);
+				if constexpr (RECORD)std::swap(p_moves, o_moves);
+				sign = -sign;
+			}
+		}
+		int diff = bitboard::popcount(p) - bitboard::popcount(o);
+		return finish(sign * ((diff > 0) - (diff < 0)));
+	}
+
+public:
+	explicit PlayoutEngine(uint64_t seed = std::random_device()()) :rng(seed), playout_count(0), evaluator(nullptr), cutoff(0) {}
+	explicit PlayoutEngine(const Xoshiro256& rng) :rng(rng), playout_count(0), evaluator(nullptr), cutoff(0) {}
+
+	// cutoff 手打ったところで止め、evaluator の評価値の符号を結果にする。evaluator が nullptr か cutoff が 0 なら最後まで打つ
+	void set_cutoff(const PatternEvaluator* evaluator, int cutoff) {
+		this->evaluator = cutoff > 0 ? evaluator : nullptr;
+		this->cutoff = cutoff;
+	}
+
+	// state の手番側から見て 勝ち:1 引き分け:0 負け:-1
+	// played があれば、state の手番側が打ったマスを played[0] に、相手が打ったマスを played[1] に書く
+	int run(const SimpleState& state, uint64_t* played = nullptr) {
+		return played ? run_impl<true>(state, played) : run_impl<false>(state, nullptr);
+	}
+
+	uint64_t get_playout_count() const {
+		return this->playout_count;
+	}
+
+	Xoshiro256& get_rng() {
+		return this->rng;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,202 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "Bitboard.cpp"
+#include "MappedFile.cpp"
+#include "SharedFile.cpp"
+#include <fstream>
+
+// 方策と評価値を出す小さな全結合ネット。重みは int8 で、推論は整数演算だけで行う
+// 入力 192 (手番側の石 64・相手の石 64・合法手 64) → 128 → 64 → 方策 64 と評価値 1。中間層は 0..1 で切る ReLU
+namespace net {
+	constexpr int INPUTS = 192;
+	constexpr int HIDDEN1 = 128;
+	constexpr int HIDDEN2 = 64;
+	constexpr int POLICY = 64;
+
+	// 中間層の出力 1.0 を 127、2 層目以降の重み 1.0 を 64 で表す。1 層目の重みは ACTIVATION_SCALE 倍
+	constexpr int ACTIVATION_SCALE = 127;
+	constexpr int WEIGHT_SCALE = 64;
+	constexpr int WEIGHT_SHIFT = 6;
+
+	// 重みファイルの中身。ファイルを写したメモリをそのまま使う
+	struct Weights {
+		int8_t w1[INPUTS][HIDDEN1];
+		int16_t b1[HIDDEN1];
+		int8_t w2[HIDDEN2][HIDDEN1];
+		int32_t b2[HIDDEN2];
+		int8_t policy_w[POLICY][HIDDEN2];
+		int32_t policy_b[POLICY];
+		int8_t value_w[HIDDEN2];
+		int32_t value_b;
+	};
+
+	struct FileHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t inputs;
+		uint32_t hidden1;
+		uint32_t hidden2;
+		uint32_t policy;
+	};
+
+	constexpr char MAGIC[4] = { 'R', 'V', 'N', 'N' };
+	constexpr uint32_t VERSION = 1;
+
+	inline bool write_file(const std::string& path, const Weights& weights) {
+		FileHeader header = { { MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3] }, VERSION, INPUTS, HIDDEN1, HIDDEN2, POLICY };
+		std::ofstream out(path, std::ios::binary);
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)&weights, sizeof(weights));
+		return (bool)out;
+	}
+
+	// 出力層の整数値から実数へ
+	constexpr float OUTPUT_SCALE = 1.0f / (ACTIVATION_SCALE * WEIGHT_SCALE);
+
+	inline void hidden1_scalar(const Weights& w, uint64_t p, uint64_t o, uint64_t legal, uint8_t* a1) {
+		int16_t acc[HIDDEN1];
+		for (int j = 0; j < HIDDEN1; j++)acc[j] = w.b1[j];
+		const uint64_t planes[3] = { p, o, legal };
+		for (int plane = 0; plane < 3; plane++) {
+			for (uint64_t b = planes[plane]; b; b &= b - 1) {
+				const int8_t* row = w.w1[plane * bitboard::CELLS + bitboard::lsb(b)];
+				for (int j = 0; j < HIDDEN1; j++)acc[j] += row[j];
+			}
+		}
+		for (int j = 0; j < HIDDEN1; j++)a1[j] = (uint8_t)std::clamp<int>(acc[j], 0, ACTIVATION_SCALE);
+	}
+
+	template <int N>
+	inline int32_t dot_scalar(const uint8_t* a, const int8_t* w) {
+		int32_t sum = 0;
+		for (int i = 0; i < N; i++)sum += a[i] * w[i];
+		return sum;
+	}
+
+	// 1 層目と 2 層目の残り。policy は合法手以外も含めた 64 マス分のロジット
+	inline void forward_scalar(const Weights& w, uint64_t p, uint64_t o, uint64_t legal, float* policy, float& value) {
+		uint8_t a1[HIDDEN1], a2[HIDDEN2];
+		hidden1_scalar(w, p, o, legal, a1);
+		for (int k = 0; k < HIDDEN2; k++) {
+			int32_t sum = w.b2[k] + dot_scalar<HIDDEN1>(a1, w.w2[k]);
+			a2[k] = (uint8_t)std::clamp(sum >> WEIGHT_SHIFT, 0, ACTIVATION_SCALE);
+		}
+		for (int m = 0; m < POLICY; m++)policy[m] = (w.policy_b[m] + dot_scalar<HIDDEN2>(a2, w.policy_w[m])) * OUTPUT_SCALE;
+		value = std::tanh((w.value_b + dot_scalar<HIDDEN2>(a2, w.value_w)) * OUTPUT_SCALE);
+	}
+
+#ifdef BITBOARD_X64
+	// 32 個の u8 と s8 の積和を 8 個の int32 にまとめる
+	BITBOARD_TARGET_AVX2 inline __m256i dot32_avx2(__m256i a, const int8_t* w, __m256i sum) {
+		__m256i products = _mm256_maddubs_epi16(a, _mm256_loadu_si256((const __m256i*)w));
+		return _mm256_add_epi32(sum, _mm256_madd_epi16(products, _mm256_set1_epi16(1)));
+	}
+
+	BITBOARD_TARGET_AVX2 inline int32_t horizontal_sum_avx2(__m256i v) {
+		__m128i x = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+		x = _mm_add_epi32(x, _mm_unpackhi_epi64(x, x));
+		x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 1));
+		return _mm_cvtsi128_si32(x);
+	}
+
+	BITBOARD_TARGET_AVX2 inline void forward_avx2(const Weights& w, uint64_t p, uint64_t o, uint64_t legal, float* policy, float& value) {
+		// 1 層目は入力が 0/1 なので、立っている入力の重みの行を int16 で足すだけ
+		__m256i acc[HIDDEN1 / 16];
+		for (int j = 0; j < HIDDEN1 / 16; j++)acc[j] = _mm256_loadu_si256((const __m256i*)(w.b1 + j * 16));
+		const uint64_t planes[3] = { p, o, legal };
+		for (int plane = 0; plane < 3; plane++) {
+			for (uint64_t b = planes[plane]; b; b &= b - 1) {
+				const int8_t* row = w.w1[plane * bitboard::CELLS + bitboard::lsb(b)];
+				for (int j = 0; j < HIDDEN1 / 16; j++) {
+					acc[j] = _mm256_add_epi16(acc[j], _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(row + j * 16))));
+				}
+			}
+		}
+		// packus は 128bit ごとに交互に詰めるので、並びを 64bit 単位で直す
+		const __m256i limit = _mm256_set1_epi8(ACTIVATION_SCALE);
+		__m256i a1[HIDDEN1 / 32];
+		for (int j = 0; j < HIDDEN1 / 32; j++) {
+			__m256i packed = _mm256_packus_epi16(acc[2 * j], acc[2 * j + 1]);
+			a1[j] = _mm256_min_epu8(_mm256_permute4x64_epi64(packed, 0xd8), limit);
+		}
+
+		alignas(32) uint8_t a2_bytes[HIDDEN2];
+		for (int k = 0; k < HIDDEN2; k++) {
+			__m256i sum = _mm256_setzero_si256();
+			for (int j = 0; j < HIDDEN1 / 32; j++)sum = dot32_avx2(a1[j], w.w2[k] + j * 32, sum);
+			a2_bytes[k] = (uint8_t)std::clamp((w.b2[k] + horizontal_sum_avx2(sum)) >> WEIGHT_SHIFT, 0, ACTIVATION_SCALE);
+		}
+		__m256i a2[HIDDEN2 / 32];
+		for (int j = 0; j < HIDDEN2 / 32; j++)a2[j] = _mm256_load_si256((const __m256i*)(a2_bytes + j * 32));
+
+		for (int m = 0; m < POLICY; m++) {
+			__m256i sum = _mm256_setzero_si256();
+			for (int j = 0; j < HIDDEN2 / 32; j++)sum = dot32_avx2(a2[j], w.policy_w[m] + j * 32, sum);
+			policy[m] = (w.policy_b[m] + horizontal_sum_avx2(sum)) * OUTPUT_SCALE;
+		}
+		__m256i sum = _mm256_setzero_si256();
+		for (int j = 0; j < HIDDEN2 / 32; j++)sum = dot32_avx2(a2[j], w.value_w + j * 32, sum);
+		value = std::tanh((w.value_b + horizontal_sum_avx2(sum)) * OUTPUT_SCALE);
+	}
+#endif
+}
+
+// 重みファイルを写したメモリから直接推論する
+class PolicyValueNet {
+private:
+	MappedFile file;
+	const net::Weights* weights;
+	bool use_avx2;
+
+public:
+	PolicyValueNet() :weights(nullptr), use_avx2(false) {
+#ifdef BITBOARD_X64
+		use_avx2 = bitboard::cpu_has_avx2();
+#endif
+	}
+
+	bool load(const std::string& path) {
+		weights = nullptr;
+		if (!file.open(path))return false;
+		const net::FileHeader* header = (const net::FileHeader*)file.data();
+		if (file.size() != sizeof(net::FileHeader) + sizeof(net::Weights) || std::memcmp(header->magic, net::MAGIC, 4) != 0 || header->version != net::VERSION
+			|| header->inputs != net::INPUTS || header->hidden1 != net::HIDDEN1 || header->hidden2 != net::HIDDEN2 || header->policy != net::POLICY) {
+			file.close();
+			return false;
+		}
+		weights = (const net::Weights*)(file.data() + sizeof(net::FileHeader));
+		return true;
+	}
+
+	bool is_loaded() const {
+		return this->weights != nullptr;
+	}
+
+	// 比較用に AVX2 を使わない経路に切り替える
+	void set_use_avx2(bool use_avx2) {
+#ifdef BITBOARD_X64
+		this->use_avx2 = use_avx2 && bitboard::cpu_has_avx2();
+#endif
+	}
+
+	// 手番側 p の局面を評価する。policy には 64 マスのロジット、value には手番側から見た -1..1 の評価値が入る
+	void evaluate(uint64_t p, uint64_t o, uint64_t legal, float* policy, float& value) const {
+#ifdef BITBOARD_X64
+		if (use_avx2) {
+			net::forward_avx2(*weights, p, o, legal, policy, value);
+			return;
+		}
+#endif
+		net::forward_scalar(*weights, p, o, legal, policy, value);
+	}
+
+	// プロセスで共有するネットを path に決めて返す。読めないか、既に別のファイルに決まっていれば nullptr
+	static const PolicyValueNet* shared(const std::string& path) {
+		return SharedFile<PolicyValueNet>::load(path);
+	}
+
+	// 共有しているネット。まだ決まっていなければ NET_WEIGHT_FILE を読む
+	static const PolicyValueNet* shared() {
+		return SharedFile<PolicyValueNet>::get(NET_WEIGHT_FILE);
+	}
+};
\ No newline at end of file
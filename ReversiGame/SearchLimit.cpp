@@ -0,0 +1,61 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include <chrono>
+
+// 探索の打ち切り条件。0 の項目は使わない
+struct SearchLimits {
+	int iterations = 0;
+	double move_time_ms = 0;
+	double game_time_ms = 0; // 対局全体の残り持ち時間
+};
+
+// 1 手分の持ち時間を決めて締め切りを管理する。past_deadline は複数スレッドから呼んでよい
+class SearchClock {
+private:
+	using clock = std::chrono::steady_clock;
+	clock::time_point start_time;
+	clock::time_point deadline;
+	bool has_deadline;
+
+public:
+	SearchClock() :start_time(clock::now()), deadline(clock::time_point::max()), has_deadline(false) {}
+
+	// 持ち時間は残り手数 (空きマスの半分、最低 TIME_MIN_MOVES_LEFT 手) で等分する
+	SearchClock(const SearchLimits& limits, int empties) :SearchClock() {
+		double budget_ms = limits.move_time_ms;
+		if (limits.game_time_ms > 0) {
+			int moves_left = std::max(TIME_MIN_MOVES_LEFT, (empties + 1) / 2);
+			double share_ms = limits.game_time_ms / moves_left;
+			budget_ms = budget_ms > 0 ? std::min(budget_ms, share_ms) : share_ms;
+		}
+		if (budget_ms > 0) {
+			this->deadline = start_time + std::chrono::microseconds((long long)(budget_ms * 1000));
+			this->has_deadline = true;
+		}
+	}
+
+	bool timed() const {
+		return this->has_deadline;
+	}
+
+	bool past_deadline() const {
+		return has_deadline && clock::now() >= deadline;
+	}
+
+	double elapsed_ms() const {
+		return std::chrono::duration<double, std::milli>(clock::now() - start_time).count();
+	}
+
+	double remaining_ms() const {
+		if (!has_deadline)return 1e300;
+		return std::max(0.0, std::chrono::duration<double, std::milli>(deadline - clock::now()).count());
+	}
+
+	// done 回の処理にかかった速さから、締め切りまでにあと何回できるか見積もる
+	double estimate_remaining(double done) const {
+		if (!has_deadline)return 1e300;
+		double elapsed = elapsed_ms();
+		if (elapsed <= 0 || done <= 0)return 1e300;
+		return done / elapsed * remaining_ms();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,110 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "Bitboard.cpp"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+// 1 手分の探索の記録。Agent::select_action が毎手埋める
+// 固定長で確保も無く、数えるのは探索が元々持っている値だけなので常に取っておける
+struct SearchStats {
+	enum class Source : uint8_t {
+		Search, // 探索した
+		Book,   // 定跡の手
+		Solver, // 終盤の完全読み
+		Forced, // 合法手が 1 つ以下
+	};
+
+	// 根の子。visits は探索回数 (alpha-beta では 0)、value は手番側から見た勝率か評価値
+	struct RootMove {
+		uint8_t move;
+		int visits;
+		float value;
+	};
+
+	static const int MAX_ROOT_MOVES = bitboard::PASS + 1;
+
+	const char* agent = "";
+	Source source = Source::Search;
+	int ply = 0;       // 初期局面からの手数
+	int empties = 0;
+	int move = bitboard::PASS;
+	uint64_t iterations = 0; // MCTS・PUCT は木の探索回数、MC は 1 手あたりのプレイアウト数、alpha-beta は読み終えた深さ
+	uint64_t playouts = 0;   // PUCT ではネットの評価回数
+	uint64_t nodes = 0;      // 木を降りた手数の合計、alpha-beta と完全読みは読んだ局面数
+	double wall_ms = 0;
+	double nodes_per_sec = 0;
+	int max_depth = 0;
+	double average_depth = 0;
+	size_t memory_bytes = 0; // 木のアリーナ、alpha-beta では置換表の使用量
+	size_t peak_memory_bytes = 0; // 探索中の memory_bytes の最大。木を刈り込めば終わりの値より大きい
+	size_t committed_memory_bytes = 0; // 探索のために確保して実際にメモリを使っている量 (詰め直し用の領域や置換表も含む)
+	int prunes = 0;               // 木が一杯になって刈り込んだ回数
+	int root_count = 0;
+	RootMove root[MAX_ROOT_MOVES];
+
+	void add_root(int move, int visits, float value) {
+		if (root_count < MAX_ROOT_MOVES)root[root_count++] = { (uint8_t)move, visits, value };
+	}
+
+	static const char* source_name(Source source) {
+		switch (source) {
+		case Source::Book: return "book";
+		case Source::Solver: return "solver";
+		case Source::Forced: return "forced";
+		default: return "search";
+		}
+	}
+};
+
+// 探索の記録を 1 手 1 行の JSON で書き出す。複数スレッドから書いてよい
+class SearchTrace {
+private:
+	std::FILE* file;
+	std::mutex mutex;
+	std::chrono::steady_clock::time_point start_time;
+
+public:
+	SearchTrace() :file(nullptr), start_time(std::chrono::steady_clock::now()) {}
+	SearchTrace(const SearchTrace&) = delete;
+	SearchTrace& operator=(const SearchTrace&) = delete;
+	~SearchTrace() {
+		close();
+	}
+
+	// 追記で開く。空の path なら何もしない
+	bool open(const std::string& path) {
+		close();
+		if (path.empty())return false;
+		this->file = std::fopen(path.c_str(), "a");
+		this->start_time = std::chrono::steady_clock::now();
+		return this->file != nullptr;
+	}
+
+	void close() {
+		if (file)std::fclose(file);
+		this->file = nullptr;
+	}
+
+	bool is_open() const {
+		return this->file != nullptr;
+	}
+
+	// game は対局の番号。t_ms は開いてからの時刻で、外れ値がいつ出たかを追うのに使う
+	void write(const SearchStats& stats, int game = 0) {
+		if (!file)return;
+		double t_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+		std::lock_guard<std::mutex> lock(mutex);
+		std::fprintf(file, "{\"t_ms\": %.3f, \"game\": %d, \"agent\": \"%s\", \"ply\": %d, \"empties\": %d, \"source\": \"%s\", \"move\": %d, "
+			"\"iterations\": %llu, \"playouts\": %llu, \"nodes\": %llu, \"wall_ms\": %.3f, \"nodes_per_sec\": %.0f, "
+			"\"max_depth\": %d, \"avg_depth\": %.2f, \"memory_bytes\": %zu, \"peak_memory_bytes\": %zu, \"committed_memory_bytes\": %zu, \"prunes\": %d, \"root\": [",
+			t_ms, game, stats.agent, stats.ply, stats.empties, SearchStats::source_name(stats.source), stats.move,
+			(unsigned long long)stats.iterations, (unsigned long long)stats.playouts, (unsigned long long)stats.nodes, stats.wall_ms, stats.nodes_per_sec,
+			stats.max_depth, stats.average_depth, stats.memory_bytes, stats.peak_memory_bytes, stats.committed_memory_bytes, stats.prunes);
+		for (int i = 0; i < stats.root_count; i++) {
+			std::fprintf(file, "%s[%d, %d, %.4g]", i ? ", " : "", stats.root[i].move, stats.root[i].visits, stats.root[i].value);
+		}
+		std::fprintf(file, "]}\n");
+		std::fflush(file);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,49 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include <mutex>
+#include <string>
+
+// パターン評価・定跡・ネットのように、プロセスで 1 つだけ読んで共有するファイル
+// 最初に決まったパスを覚えておき、後から別のパスを求められたら nullptr を返す。呼ぶ順番で黙って別のファイルが使われないようにする
+template <class T>
+class SharedFile {
+private:
+	struct Slot {
+		std::mutex mutex;
+		T value;
+		std::string path;
+		bool chosen = false;
+		bool loaded = false;
+	};
+
+	static Slot& slot() {
+		static Slot s;
+		return s;
+	}
+
+public:
+	// path を読む。空なら何も読まない。既に別のパスに決まっていれば nullptr
+	static const T* load(const std::string& path) {
+		Slot& s = slot();
+		std::lock_guard<std::mutex> lock(s.mutex);
+		if (!s.chosen) {
+			s.chosen = true;
+			s.path = path;
+			s.loaded = !path.empty() && s.value.load(path);
+		}
+		else if (path != s.path)return nullptr;
+		return s.loaded ? &s.value : nullptr;
+	}
+
+	// 既に決まったものを返す。まだ何も決まっていなければ default_path を読む
+	static const T* get(const std::string& default_path) {
+		Slot& s = slot();
+		std::lock_guard<std::mutex> lock(s.mutex);
+		if (!s.chosen) {
+			s.chosen = true;
+			s.path = default_path;
+			s.loaded = s.value.load(default_path);
+		}
+		return s.loaded ? &s.value : nullptr;
+	}
+};
\ No newline at end of file
@@ -1,125 +1,207 @@
-#pragma once
-#include "Define.h"
+﻿#pragma once
+#include "EngineDefine.h"
+#include "Bitboard.cpp"
+#include "Zobrist.cpp"
+
+// make_move で戻すための情報
+struct MoveUndo {
+	uint64_t flipped;
+	uint64_t legal;
+	uint64_t hash;
+	uint8_t pos;
+	bool pass_end;
+};
 
 class SimpleState {
 private:
 	bool pass_end;
-	std::vector<std::vector<int>> board;
-	int height;
-	int width;
+	uint8_t player_count;
+	uint8_t opponent_count;
+	uint64_t player;
+	uint64_t opponent;
+	uint64_t legal; // 手番側の合法手
 	int depth;
+	uint64_t hash;
 
-	std::vector<std::pair<int, int>> get_action_flip_list(int y,int x) const {
-		std::vector<std::pair<int, int>> updates;
-		for (int dy = -1; dy <= 1; dy++) {
-			for (int dx = -1; dx <= 1; dx++) {
-				if (dx == 0 && dy == 0)continue;
-				std::vector<std::pair<int, int>> tmp;
-				int nx = x + dx, ny = y + dy;
-				while (0 <= nx && nx < width && 0 <= ny && ny < height && getColor(ny,nx) != -1) {
-					if (teban() != getColor(ny,nx))
-						tmp.emplace_back(ny, nx);
-					else {
-						for (auto p : tmp) {
-							updates.push_back(p);
-						}
-						break;
-					}
-					nx += dx, ny += dy;
-				}
-			}
+	static uint64_t flip_hash(int color, int pos, uint64_t flipped) {
+		uint64_t h = zobrist::KEYS.stone[color][pos];
+		for (uint64_t f = flipped; f; f &= f - 1) {
+			h ^= zobrist::KEYS.flip[bitboard::lsb(f)];
 		}
-		return updates;
+		return h;
 	}
 
-	bool is_legal_action(int y,int x) const {
-		if (getColor(y, x) != -1)return false;
-		auto updates = get_action_flip_list(y, x);
-		return updates.size() != 0;
+	// 盤面から石数・合法手・ハッシュを作り直す
+	void refresh() {
+		this->player_count = (uint8_t)bitboard::popcount(player);
+		this->opponent_count = (uint8_t)bitboard::popcount(opponent);
+		this->legal = bitboard::legal_moves(player, opponent);
+		this->hash = zobrist::compute(player, opponent, teban(), pass_end);
 	}
 
-	bool take_action(int y, int x) {
-		board[y][x] = teban();
-		auto updates = get_action_flip_list(y, x);
-		for (auto [py, px] : updates) {
-			board[py][px] = teban();
+	void set_pass_end(bool pass_end) {
+		if (this->pass_end != pass_end) {
+			this->pass_end = pass_end;
+			this->hash ^= zobrist::KEYS.pass_end;
 		}
-		return updates.size() != 0;
 	}
 
 public:
-	SimpleState() {
-		this->board = std::vector<std::vector<int>>();
+	SimpleState() :pass_end(false), player_count(0), opponent_count(0), player(0), opponent(0), legal(0), depth(0), hash(0) {}
+	SimpleState(std::vector<std::vector<int>> board, int depth) :pass_end(false), player(0), opponent(0), depth(depth) {
+		assert(board.size() == bitboard::SIZE && board[0].size() == bitboard::SIZE);
+		for (int i = 0; i < bitboard::SIZE; i++) {
+			for (int j = 0; j < bitboard::SIZE; j++) {
+				if (board[i][j] == -1)continue;
+				if (board[i][j] == teban()) {
+					this->player |= bitboard::bit(bitboard::to_pos(i, j));
+				}
+				else {
+					this->opponent |= bitboard::bit(bitboard::to_pos(i, j));
+				}
+			}
+		}
+		refresh();
 	}
-	SimpleState(std::vector<std::vector<int>> board,int depth) {
-		this->board = board;
-		this->depth = depth;
-		this->height = board.size();
-		this->width = board[0].size();
-		this->pass_end = false;
+	SimpleState(uint64_t player, uint64_t opponent, int depth) :pass_end(false), player(player), opponent(opponent), depth(depth) {
+		refresh();
 	}
 
 	bool teban() const {
 		return this->depth % 2;
 	}
 
+	// 手番側、相手の順
 	std::pair<int, int> stone_count() const {
-		std::pair<int, int> ret = { 0,0 };
-		for (auto row : board) {
-			for (auto cell : row) {
-				if (cell == -1)continue;
-				if (cell == teban()) {
-					ret.first++;
-				}
-				else {
-					ret.second++;
-				}
-			}
-		}
-		return ret;
+		return { player_count, opponent_count };
+	}
+
+	// 手番側から見た石差
+	int disc_difference() const {
+		return (int)player_count - opponent_count;
 	}
 
 	int getColor(int y, int x) const {
-		return this->board[y][x];
+		uint64_t b = bitboard::bit(bitboard::to_pos(y, x));
+		if (player & b)return teban();
+		if (opponent & b)return !teban();
+		return -1;
+	}
+
+	bool operator==(const SimpleState& other) const {
+		return hash == other.hash && player == other.player && opponent == other.opponent && depth == other.depth && pass_end == other.pass_end;
+	}
+
+	uint64_t get_player() const {
+		return this->player;
+	}
+
+	uint64_t get_opponent() const {
+		return this->opponent;
+	}
+
+	uint64_t get_hash() const {
+		return this->hash;
 	}
 
-	SimpleState next(std::pair<int, int> action) {
-		SimpleState state = SimpleState(this->board, this->depth);
-		if (action != std::make_pair(-1, -1)) {
-			state.take_action(action.first, action.second);
+	int get_depth() const {
+		return this->depth;
+	}
+
+	int empty_count() const {
+		return bitboard::CELLS - player_count - opponent_count;
+	}
+
+	uint64_t legal_moves() const {
+		return this->legal;
+	}
+
+	// pos は 0..63 のマス番号、bitboard::PASS でパス。その場で打ち、unmake_move で戻せる
+	MoveUndo make_move(int pos) {
+		MoveUndo undo = { 0, legal, hash, (uint8_t)pos, pass_end };
+		set_pass_end(false);
+		if (pos != bitboard::PASS) {
+			uint64_t move = bitboard::bit(pos);
+			undo.flipped = bitboard::flips(player, opponent, move);
+			player |= move | undo.flipped;
+			opponent &= ~undo.flipped;
+			int flip_count = bitboard::popcount(undo.flipped);
+			player_count += (uint8_t)(flip_count + 1);
+			opponent_count -= (uint8_t)flip_count;
+			hash ^= flip_hash(teban(), pos, undo.flipped);
 		}
-		state.depth++;
-		auto legal_actions = state.legal_actions();
-		if (action == std::make_pair(-1, -1) && legal_actions[0] == std::make_pair(-1, -1)) {
-			state.pass_end = true;
+		std::swap(player, opponent);
+		std::swap(player_count, opponent_count);
+		depth++;
+		hash ^= zobrist::KEYS.side;
+		legal = bitboard::legal_moves(player, opponent);
+		if (pos == bitboard::PASS && legal == 0) {
+			set_pass_end(true);
+		}
+		return undo;
+	}
+
+	void unmake_move(const MoveUndo& undo) {
+		std::swap(player, opponent);
+		std::swap(player_count, opponent_count);
+		depth--;
+		if (undo.pos != bitboard::PASS) {
+			player &= ~(bitboard::bit(undo.pos) | undo.flipped);
+			opponent |= undo.flipped;
+			int flip_count = bitboard::popcount(undo.flipped);
+			player_count -= (uint8_t)(flip_count + 1);
+			opponent_count += (uint8_t)flip_count;
 		}
+		legal = undo.legal;
+		hash = undo.hash;
+		pass_end = undo.pass_end;
+	}
+
+	SimpleState next(int pos) const {
+		SimpleState state = *this;
+		state.make_move(pos);
 		return state;
 	}
 
+	// next(pos).get_hash() と同じ値を、合法手を作らずに出す
+	uint64_t hash_after(int pos) const {
+		uint64_t h = hash ^ (pass_end ? zobrist::KEYS.pass_end : 0) ^ zobrist::KEYS.side;
+		if (pos != bitboard::PASS) {
+			h ^= flip_hash(teban(), pos, bitboard::flips(player, opponent, bitboard::bit(pos)));
+		}
+		else if (bitboard::legal_moves(opponent, player) == 0) {
+			h ^= zobrist::KEYS.pass_end;
+		}
+		return h;
+	}
+
+	SimpleState next(std::pair<int, int> action) const {
+		if (action == std::make_pair(-1, -1)) {
+			return next(bitboard::PASS);
+		}
+		return next(bitboard::to_pos(action.first, action.second));
+	}
+
 	std::vector<std::pair<int, int>> legal_actions() const {
 		std::vector<std::pair<int, int>> ret;
-		for (int i = 0; i < board.size(); i++) {
-			for (int j = 0; j < board[0].size(); j++) {
-				if (is_legal_action(i, j))ret.emplace_back(i, j);
-			}
+		for (uint64_t moves = legal_moves(); moves; moves &= moves - 1) {
+			int pos = bitboard::lsb(moves);
+			ret.emplace_back(pos / bitboard::SIZE, pos % bitboard::SIZE);
 		}
 		ret.emplace_back(-1, -1);
 		return ret;
 	}
 
 	bool is_lose() const {
-		auto stones = stone_count();
-		return is_done() && stones.first < stones.second;
+		return is_done() && player_count < opponent_count;
 	}
 
 	bool is_draw() const {
-		auto stones = stone_count();
-		return is_done() && stones.first == stones.second;
+		return is_done() && player_count == opponent_count;
 	}
 
 	bool is_done() const {
-		auto stones = stone_count();
-		return stones.first + stones.second == (int)(board.size()) * (int)(board[0].size()) || this->pass_end;
+		return player_count + opponent_count == bitboard::CELLS || this->pass_end;
 	}
 
 };
\ No newline at end of file
@@ -0,0 +1,400 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "Bitboard.cpp"
+#include "SimpleState.cpp"
+#include "Playout.cpp"
+#include <type_traits>
+#include <variant>
+
+// 盤の大きさをテンプレート引数にした盤面演算 (bit = y * N + x)
+// 方向ごとのマスクと隣接表は大きさごとに constexpr で作り、シフト量も定数なので各大きさで分岐の無いコードになる。8x8 は bitboard の命令セット別カーネルをそのまま使う
+namespace sized {
+	// 10x10 は 100 マスあるので 2 語で持つ (MSVC には __int128 が無い)
+	struct Bits128 {
+		uint64_t lo, hi;
+
+		constexpr Bits128() :lo(0), hi(0) {}
+		constexpr Bits128(uint64_t lo, uint64_t hi = 0) :lo(lo), hi(hi) {}
+
+		constexpr Bits128 operator&(Bits128 b) const { return { lo & b.lo, hi & b.hi }; }
+		constexpr Bits128 operator|(Bits128 b) const { return { lo | b.lo, hi | b.hi }; }
+		constexpr Bits128 operator^(Bits128 b) const { return { lo ^ b.lo, hi ^ b.hi }; }
+		constexpr Bits128 operator~() const { return { ~lo, ~hi }; }
+		constexpr Bits128& operator&=(Bits128 b) { return *this = *this & b; }
+		constexpr Bits128& operator|=(Bits128 b) { return *this = *this | b; }
+		constexpr Bits128& operator^=(Bits128 b) { return *this = *this ^ b; }
+		constexpr bool operator==(Bits128 b) const { return lo == b.lo && hi == b.hi; }
+		constexpr explicit operator bool() const { return (lo | hi) != 0; }
+
+		// s は定数で呼ぶので、インライン展開で分岐は消える
+		constexpr Bits128 operator<<(int s) const {
+			if (s == 0)return *this;
+			if (s >= 64)return { 0, lo << (s - 64) };
+			return { lo << s, (hi << s) | (lo >> (64 - s)) };
+		}
+		constexpr Bits128 operator>>(int s) const {
+			if (s == 0)return *this;
+			if (s >= 64)return { hi >> (s - 64), 0 };
+			return { (lo >> s) | (hi << (64 - s)), hi >> s };
+		}
+	};
+
+	inline int popcount(uint64_t b) {
+		return std::popcount(b);
+	}
+
+	inline int popcount(Bits128 b) {
+		return std::popcount(b.lo) + std::popcount(b.hi);
+	}
+
+	inline int lsb(uint64_t b) {
+		return std::countr_zero(b);
+	}
+
+	inline int lsb(Bits128 b) {
+		return b.lo ? std::countr_zero(b.lo) : 64 + std::countr_zero(b.hi);
+	}
+
+	// 最下位の 1 を消す
+	inline uint64_t clear_lsb(uint64_t b) {
+		return b & (b - 1);
+	}
+
+	inline Bits128 clear_lsb(Bits128 b) {
+		if (b.lo)return { b.lo & (b.lo - 1), b.hi };
+		return { 0, b.hi & (b.hi - 1) };
+	}
+
+	template <int N>
+	struct Geometry {
+		static_assert(N >= 4 && N <= 10 && N % 2 == 0, "board size must be even and between 4 and 10");
+
+		using Bits = std::conditional_t<N * N <= 64, uint64_t, Bits128>;
+		static constexpr int SIZE = N;
+		static constexpr int CELLS = N * N;
+		static constexpr int PASS = N * N;
+		// 挟める石の並びは最長 N - 2。倍々に伸ばす回数
+		static constexpr int FILL_STEPS = N - 2 <= 3 ? 2 : (N - 2 <= 7 ? 3 : 4);
+
+		static constexpr Bits bit(int pos) {
+			return Bits(1) << pos;
+		}
+
+		static constexpr Bits make_mask(int x_margin, int y_margin) {
+			Bits b = 0;
+			for (int y = y_margin; y < N - y_margin; y++) {
+				for (int x = x_margin; x < N - x_margin; x++)b |= bit(y * N + x);
+			}
+			return b;
+		}
+
+		// 横・縦・斜めのシフトで反対側の辺へ回り込まないためのマスク
+		static constexpr Bits FULL = make_mask(0, 0);
+		static constexpr Bits MASK_H = make_mask(1, 0);
+		static constexpr Bits MASK_V = make_mask(0, 1);
+		static constexpr Bits MASK_D = make_mask(1, 1);
+
+		// 8 近傍のマス。隣に相手の石が無いマスはどの方向にも返せない
+		static constexpr std::array<Bits, CELLS> make_neighbors() {
+			std::array<Bits, CELLS> table = {};
+			for (int pos = 0; pos < CELLS; pos++) {
+				int x = pos % N, y = pos / N;
+				for (int dy = -1; dy <= 1; dy++) {
+					for (int dx = -1; dx <= 1; dx++) {
+						int nx = x + dx, ny = y + dy;
+						if ((dx || dy) && 0 <= nx && nx < N && 0 <= ny && ny < N)table[pos] |= bit(ny * N + nx);
+					}
+				}
+			}
+			return table;
+		}
+
+		static constexpr std::array<Bits, CELLS> NEIGHBORS = make_neighbors();
+
+		// 中央の 4 マス。黒 (先手) が右上と左下
+		static constexpr Bits INITIAL_PLAYER = bit((N / 2 - 1) * N + N / 2) | bit((N / 2) * N + N / 2 - 1);
+		static constexpr Bits INITIAL_OPPONENT = bit((N / 2 - 1) * N + N / 2 - 1) | bit((N / 2) * N + N / 2);
+	};
+
+	template <int S, class Bits>
+	inline Bits shift(Bits b) {
+		if constexpr (std::is_same_v<Bits, Bits128>) {
+			// 語をまたぐ分をコンパイル時に決めておく
+			if constexpr (S >= 64) return { 0, b.lo << (S - 64) };
+			else if constexpr (S > 0) return { b.lo << S, (b.hi << S) | (b.lo >> (64 - S)) };
+			else if constexpr (S <= -64) return { b.hi >> (-S - 64), 0 };
+			else return { (b.lo >> -S) | (b.hi << (64 + S)), b.hi >> -S };
+		}
+		else if constexpr (S > 0) return b << S;
+		else return b >> -S;
+	}
+
+	// Kogge-Stone の occluded fill。STEPS 回で 2^STEPS - 1 マス先まで伸ばす
+	template <int S, int STEPS, class Bits>
+	inline Bits fill(Bits gen, Bits pro) {
+		gen |= pro & shift<S>(gen);
+		if constexpr (STEPS > 1) {
+			pro &= shift<S>(pro);
+			return fill<2 * S, STEPS - 1>(gen, pro);
+		}
+		return gen;
+	}
+
+	template <int N, int S, class Bits>
+	inline Bits moves_dir(Bits p, Bits pro) {
+		return shift<S>(fill<S, Geometry<N>::FILL_STEPS>(p, pro) & pro);
+	}
+
+	template <int N, int S, class Bits>
+	inline Bits flips_dir(Bits p, Bits pro, Bits move) {
+		Bits f = fill<S, Geometry<N>::FILL_STEPS>(move, pro) & pro;
+		return (shift<S>(f) & p) ? f : Bits(0);
+	}
+
+	template <int N>
+	inline typename Geometry<N>::Bits legal_moves(typename Geometry<N>::Bits p, typename Geometry<N>::Bits o) {
+		using G = Geometry<N>;
+		if constexpr (N == bitboard::SIZE) {
+			return bitboard::legal_moves(p, o);
+		}
+		else {
+			typename G::Bits h = o & G::MASK_H, v = o & G::MASK_V, d = o & G::MASK_D;
+			typename G::Bits moves = moves_dir<N, 1>(p, h) | moves_dir<N, -1>(p, h)
+				| moves_dir<N, N>(p, v) | moves_dir<N, -N>(p, v)
+				| moves_dir<N, N - 1>(p, d) | moves_dir<N, -(N - 1)>(p, d)
+				| moves_dir<N, N + 1>(p, d) | moves_dir<N, -(N + 1)>(p, d);
+			return moves & ~(p | o) & G::FULL;
+		}
+	}
+
+	template <int N>
+	inline typename Geometry<N>::Bits flips(typename Geometry<N>::Bits p, typename Geometry<N>::Bits o, int pos) {
+		using G = Geometry<N>;
+		if constexpr (N == bitboard::SIZE) {
+			return bitboard::flips(p, o, bitboard::bit(pos));
+		}
+		else {
+			if (!(G::NEIGHBORS[pos] & o))return 0;
+			typename G::Bits move = G::bit(pos), h = o & G::MASK_H, v = o & G::MASK_V, d = o & G::MASK_D;
+			return flips_dir<N, 1>(p, h, move) | flips_dir<N, -1>(p, h, move)
+				| flips_dir<N, N>(p, v, move) | flips_dir<N, -N>(p, v, move)
+				| flips_dir<N, N - 1>(p, d, move) | flips_dir<N, -(N - 1)>(p, d, move)
+				| flips_dir<N, N + 1>(p, d, move) | flips_dir<N, -(N + 1)>(p, d, move);
+		}
+	}
+
+	// bitboard::perft と同じ数え方 (パスも 1 手、両者打てなければ葉)
+	template <int N>
+	inline uint64_t perft(typename Geometry<N>::Bits p, typename Geometry<N>::Bits o, int depth, bool passed = false) {
+		if (depth == 0)return 1;
+		auto moves = legal_moves<N>(p, o);
+		if (!moves) {
+			if (passed)return 1;
+			return perft<N>(o, p, depth - 1, true);
+		}
+		uint64_t count = 0;
+		for (; moves; moves = clear_lsb(moves)) {
+			int pos = lsb(moves);
+			auto f = flips<N>(p, o, pos);
+			count += perft<N>(o & ~f, p | Geometry<N>::bit(pos) | f, depth - 1);
+		}
+		return count;
+	}
+
+	// 初期局面からの perft の値。8x8 は bitboard::PERFT_COUNTS と同じ
+	constexpr uint64_t PERFT_COUNTS_6[] = { 1, 4, 12, 56, 244, 1364, 7604, 47740, 308716, 2114912, 14976792 };
+	constexpr uint64_t PERFT_COUNTS_10[] = { 1, 4, 12, 56, 244, 1396, 8200, 55180, 392268, 3045812 };
+}
+
+// SimpleState と同じ規則を任意の大きさの盤で扱う。GUI と道具で使う分だけの機能に絞っている
+template <int N>
+class SizedState {
+public:
+	using Geometry = sized::Geometry<N>;
+	using Bits = typename Geometry::Bits;
+
+private:
+	bool pass_end;
+	Bits player;
+	Bits opponent;
+	Bits legal; // 手番側の合法手
+	int depth;
+
+public:
+	SizedState() :pass_end(false), player(Geometry::INITIAL_PLAYER), opponent(Geometry::INITIAL_OPPONENT), depth(0) {
+		this->legal = sized::legal_moves<N>(player, opponent);
+	}
+	SizedState(const std::vector<std::vector<int>>& board, int depth) :pass_end(false), player(0), opponent(0), depth(depth) {
+		assert(board.size() == N && board[0].size() == N);
+		for (int i = 0; i < N; i++) {
+			for (int j = 0; j < N; j++) {
+				if (board[i][j] == -1)continue;
+				if (board[i][j] == teban()) {
+					this->player |= Geometry::bit(i * N + j);
+				}
+				else {
+					this->opponent |= Geometry::bit(i * N + j);
+				}
+			}
+		}
+		this->legal = sized::legal_moves<N>(player, opponent);
+	}
+
+	bool teban() const {
+		return this->depth % 2;
+	}
+
+	// 手番側、相手の順
+	std::pair<int, int> stone_count() const {
+		return { sized::popcount(player), sized::popcount(opponent) };
+	}
+
+	int disc_difference() const {
+		return sized::popcount(player) - sized::popcount(opponent);
+	}
+
+	int getColor(int y, int x) const {
+		Bits b = Geometry::bit(y * N + x);
+		if (player & b)return teban();
+		if (opponent & b)return !teban();
+		return -1;
+	}
+
+	Bits get_player() const {
+		return this->player;
+	}
+
+	Bits get_opponent() const {
+		return this->opponent;
+	}
+
+	Bits legal_moves() const {
+		return this->legal;
+	}
+
+	int get_depth() const {
+		return this->depth;
+	}
+
+	int empty_count() const {
+		return Geometry::CELLS - sized::popcount(player | opponent);
+	}
+
+	// pos は 0..N*N-1 のマス番号、Geometry::PASS でパス
+	SizedState next(int pos) const {
+		SizedState state = *this;
+		if (pos != Geometry::PASS) {
+			Bits f = sized::flips<N>(player, opponent, pos);
+			state.player = opponent & ~f;
+			state.opponent = player | Geometry::bit(pos) | f;
+		}
+		else {
+			state.player = opponent;
+			state.opponent = player;
+		}
+		state.depth++;
+		state.legal = sized::legal_moves<N>(state.player, state.opponent);
+		state.pass_end = pos == Geometry::PASS && !state.legal;
+		return state;
+	}
+
+	SizedState next(std::pair<int, int> action) const {
+		if (action == std::make_pair(-1, -1)) {
+			return next(Geometry::PASS);
+		}
+		return next(action.first * N + action.second);
+	}
+
+	std::vector<std::pair<int, int>> legal_actions() const {
+		std::vector<std::pair<int, int>> ret;
+		for (Bits moves = legal; moves; moves = sized::clear_lsb(moves)) {
+			int pos = sized::lsb(moves);
+			ret.emplace_back(pos / N, pos % N);
+		}
+		ret.emplace_back(-1, -1);
+		return ret;
+	}
+
+	bool is_lose() const {
+		return is_done() && disc_difference() < 0;
+	}
+
+	bool is_draw() const {
+		return is_done() && disc_difference() == 0;
+	}
+
+	bool is_done() const {
+		return !(~(player | opponent) & Geometry::FULL) || this->pass_end;
+	}
+};
+
+namespace sized {
+	template <int N>
+	inline int random_move(typename Geometry<N>::Bits moves, Xoshiro256& rng) {
+		for (uint32_t k = rng.bounded(popcount(moves)); k; k--)moves = clear_lsb(moves);
+		return lsb(moves);
+	}
+
+	// 終局まで乱択で打ち、state の手番側から見た 勝ち 1 / 引き分け 0 / 負け -1
+	template <int N>
+	inline int playout(SizedState<N> state, Xoshiro256& rng) {
+		int color = state.teban();
+		while (!state.is_done()) {
+			auto moves = state.legal_moves();
+			state = state.next(moves ? random_move<N>(moves, rng) : Geometry<N>::PASS);
+		}
+		int diff = state.teban() == color ? state.disc_difference() : -state.disc_difference();
+		return (diff > 0) - (diff < 0);
+	}
+
+	// 8x8 以外の盤で CPU が使う素朴なモンテカルロ。合法手ごとに playouts 回打って勝率の高い手を返す
+	template <int N>
+	inline std::pair<int, int> monte_carlo_action(const SizedState<N>& state, int playouts, Xoshiro256& rng) {
+		auto moves = state.legal_moves();
+		if (!moves)return { -1, -1 };
+		int best = lsb(moves), best_score = INT_MIN;
+		if (playouts > 0 && clear_lsb(moves)) {
+			for (; moves; moves = clear_lsb(moves)) {
+				int pos = lsb(moves), score = 0;
+				SizedState<N> child = state.next(pos);
+				for (int i = 0; i < playouts; i++)score -= playout<N>(child, rng);
+				if (score > best_score) {
+					best_score = score;
+					best = pos;
+				}
+			}
+		}
+		else if (playouts == 0) {
+			best = random_move<N>(moves, rng);
+		}
+		return { best / N, best % N };
+	}
+}
+
+// GUI の盤から大きさを見て、対応する盤の型に振り分ける。8x8 は探索エージェントがそのまま使える SimpleState
+using AnyState = std::variant<SizedState<6>, SimpleState, SizedState<10>>;
+
+inline bool is_supported_board_size(int size) {
+	return size == 6 || size == bitboard::SIZE || size == 10;
+}
+
+inline AnyState make_any_state(const std::vector<std::vector<int>>& board, int depth) {
+	assert(is_supported_board_size((int)board.size()));
+	switch (board.size()) {
+	case 6:
+		return SizedState<6>(board, depth);
+	case 10:
+		return SizedState<10>(board, depth);
+	default:
+		return SimpleState(board, depth);
+	}
+}
+
+// 石を置いていない大きさ size の盤に、中央の 4 マスだけ置いたもの (-1 空き、0 黒、1 白)
+inline std::vector<std::vector<int>> initial_board(int size) {
+	std::vector<std::vector<int>> board(size, std::vector<int>(size, -1));
+	int c = size / 2;
+	board[c - 1][c - 1] = board[c][c] = 1;
+	board[c - 1][c] = board[c][c - 1] = 0;
+	return board;
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// ワーカーごとにタスクのキューを持ち、自分のキューが空になったら他のキューの先頭から盗む
+class ThreadPool {
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<int> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> threads;
+	std::function<void(int, int)> job;
+	std::atomic<int> pending;
+	std::mutex mutex;
+	std::condition_variable start_cv;
+	std::condition_variable done_cv;
+	uint64_t generation;
+	bool stopping;
+
+	bool pop(int worker, int& task) {
+		Queue& own = *queues[worker];
+		{
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.tasks.empty()) {
+				task = own.tasks.back();
+				own.tasks.pop_back();
+				return true;
+			}
+		}
+		for (size_t i = 1; i < queues.size(); i++) {
+			Queue& victim = *queues[(worker + i) % queues.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tasks.empty()) {
+				task = victim.tasks.front();
+				victim.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void work(int worker) {
+		int task;
+		while (pop(worker, task)) {
+			job(task, worker);
+			if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				std::lock_guard<std::mutex> lock(mutex);
+				done_cv.notify_all();
+			}
+		}
+	}
+
+	void worker_loop(int worker) {
+		uint64_t seen = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				start_cv.wait(lock, [&]() { return stopping || generation != seen; });
+				if (stopping)return;
+				seen = generation;
+			}
+			work(worker);
+		}
+	}
+
+public:
+	// thread_count には呼び出し側のスレッドも含む
+	explicit ThreadPool(int thread_count) :pending(0), generation(0), stopping(false) {
+		thread_count = std::max(1, thread_count);
+		for (int i = 0; i < thread_count; i++) {
+			queues.push_back(std::make_unique<Queue>());
+		}
+		for (int i = 1; i < thread_count; i++) {
+			threads.emplace_back([this, i]() { worker_loop(i); });
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		start_cv.notify_all();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+	}
+
+	int size() const {
+		return (int)queues.size();
+	}
+
+	// 0..task_count-1 を各キューに順に配って f(task, worker) を実行し、全部終わるまで待つ
+	void parallel_for(int task_count, const std::function<void(int, int)>& f) {
+		if (task_count <= 0)return;
+		if (queues.size() == 1) {
+			for (int task = 0; task < task_count; task++) {
+				f(task, 0);
+			}
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = f;
+			pending.store(task_count, std::memory_order_relaxed);
+			for (int task = 0; task < task_count; task++) {
+				Queue& queue = *queues[task % queues.size()];
+				std::lock_guard<std::mutex> queue_lock(queue.mutex);
+				queue.tasks.push_back(task);
+			}
+			generation++;
+		}
+		start_cv.notify_all();
+		work(0);
+		std::unique_lock<std::mutex> lock(mutex);
+		done_cv.wait(lock, [&]() { return pending.load(std::memory_order_acquire) == 0; });
+	}
+};
\ No newline at end of file
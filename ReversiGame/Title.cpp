@@ -4,21 +4,27 @@
 class Title :public MyApp::Scene {
 private:
 
-	Rect button_weak = Rect(Arg::center = Scene::Center().movedBy(-250, 0), 200, 60);
+	Rect button_weak = Rect(Arg::center = Scene::Center().movedBy(-285, 0), 180, 60);
 	Transition button_weak_transition = Transition(0.4s, 0.2s);
 
-	Rect button_normal = Rect(Arg::center = Scene::Center().movedBy(0, 0), 200, 60);
+	Rect button_normal = Rect(Arg::center = Scene::Center().movedBy(-95, 0), 180, 60);
 	Transition button_normal_transition = Transition(0.4s, 0.2s);
 
-	Rect button_strong = Rect(Arg::center = Scene::Center().movedBy(250, 0), 200, 60);
+	Rect button_strong = Rect(Arg::center = Scene::Center().movedBy(95, 0), 180, 60);
 	Transition button_strong_transition = Transition(0.4s, 0.2s);
 
+	Rect button_strongest = Rect(Arg::center = Scene::Center().movedBy(285, 0), 180, 60);
+	Transition button_strongest_transition = Transition(0.4s, 0.2s);
+
 	Rect button_exit = Rect(Arg::center = Scene::Center().movedBy(0, 100), 300, 60);
 	Transition button_exit_transition = Transition(0.4s, 0.2s);
 
 	Rect button_player_turn = Rect(Arg::center = Scene::Center().movedBy(0, 200), 250, 50);
 	Transition button_player_turn_transition = Transition(0.4s, 0.2s);
 
+	Rect button_board_size = Rect(Arg::center = Scene::Center().movedBy(285, 200), 180, 50);
+	Transition button_board_size_transition = Transition(0.4s, 0.2s);
+
 public:
 	Title(const InitData& init) :IScene(init) {}
 
@@ -26,16 +32,22 @@ public:
 		button_weak_transition.update(button_weak.mouseOver());
 		button_normal_transition.update(button_normal.mouseOver());
 		button_strong_transition.update(button_strong.mouseOver());
+		button_strongest_transition.update(button_strongest.mouseOver());
 		button_exit_transition.update(button_exit.mouseOver());
 		button_player_turn_transition.update(button_player_turn.mouseOver());
+		button_board_size_transition.update(button_board_size.mouseOver());
 
-		if (button_weak.mouseOver() || button_normal.mouseOver() || button_strong.mouseOver() || button_player_turn.mouseOver() || button_exit.mouseOver()) {
+		if (button_weak.mouseOver() || button_normal.mouseOver() || button_strong.mouseOver() || button_strongest.mouseOver() || button_player_turn.mouseOver() || button_board_size.mouseOver() || button_exit.mouseOver()) {
 			Cursor::RequestStyle(CursorStyle::Hand);
 		}
 
 		if (button_player_turn.leftClicked()) {
 			getData().player_is_first = !getData().player_is_first;
 		}
+		if (button_board_size.leftClicked()) {
+			// 6  8  10  6 ̏ɐ؂ւ
+			getData().board_size = getData().board_size >= 10 ? 6 : getData().board_size + 2;
+		}
 		if (button_weak.leftClicked()) {
 			getData().cpuType = 0;
 			changeScene(State::Game);
@@ -48,6 +60,10 @@ public:
 			getData().cpuType = 2;
 			changeScene(State::Game);
 		}
+		if (button_strongest.leftClicked()) {
+			getData().cpuType = 3;
+			changeScene(State::Game);
+		}
 
 		if (button_exit.leftClicked()) {
 			System::Exit();
@@ -63,16 +79,20 @@ public:
 		button_weak.draw(ColorF(1.0, button_weak_transition.value())).drawFrame(2);
 		button_normal.draw(ColorF(1.0, button_normal_transition.value())).drawFrame(2);
 		button_strong.draw(ColorF(1.0, button_strong_transition.value())).drawFrame(2);
+		button_strongest.draw(ColorF(1.0, button_strongest_transition.value())).drawFrame(2);
 		button_exit.draw(ColorF(1.0, button_exit_transition.value())).drawFrame(2);
 		button_player_turn.draw(ColorF(1.0, button_player_turn_transition.value())).drawFrame(2);
+		button_board_size.draw(ColorF(1.0, button_board_size_transition.value())).drawFrame(2);
 
 
 		FontAsset(U"Menu")(U"킢").drawAt(button_weak.center(), ColorF(0.25));
 		FontAsset(U"Menu")(U"ӂ").drawAt(button_normal.center(), ColorF(0.25));
 		FontAsset(U"Menu")(U"悢").drawAt(button_strong.center(), ColorF(0.25));
+		FontAsset(U"Menu")(U"傤").drawAt(button_strongest.center(), ColorF(0.25));
 		FontAsset(U"Menu")(U"").drawAt(button_exit.center(), ColorF(0.25));
 
 		FontAsset(U"Menu")(U"{}ŃvC!"_fmt(getData().player_is_first ? U"" : U"")).drawAt(button_player_turn.center(), ColorF(0.0));
+		FontAsset(U"Menu")(U"{}x{}̔"_fmt(getData().board_size, getData().board_size)).drawAt(button_board_size.center(), ColorF(0.0));
 
 	}
 };
@@ -0,0 +1,119 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include <atomic>
+
+// 置換表の 1 項目。w, n は TreeNode と同じく、その局面の手番側から見た値
+struct TTEntry {
+	std::atomic<uint64_t> key; // 上位 56 ビットがハッシュ、下位 8 ビットが世代。0 は空き
+	std::atomic<int32_t> w;
+	std::atomic<int32_t> n;
+};
+
+// 局面のハッシュから MCTS の統計を引く固定サイズの表。手順が違っても同じ局面なら統計を共有する
+// ロックは使わず、場所の確保は key の CAS だけで行う。置き換えの直後に前の局面への加算が混ざることはあるが、探索の揺らぎとして許す
+class TranspositionTable {
+private:
+	static const int BUCKET_SIZE = 4;
+	static const uint64_t GENERATION_MASK = 0xFF;
+
+	// 1 バケットがキャッシュライン 1 本に収まるようにする
+	struct alignas(64) Bucket {
+		TTEntry entries[BUCKET_SIZE];
+	};
+
+	std::unique_ptr<Bucket[]> buckets;
+	uint64_t mask;
+	uint8_t generation;
+
+	uint64_t make_key(uint64_t hash) const {
+		return (hash & ~GENERATION_MASK) | generation;
+	}
+
+	static bool matches(uint64_t key, uint64_t hash) {
+		return key != 0 && ((key ^ hash) & ~GENERATION_MASK) == 0;
+	}
+
+	Bucket& bucket(uint64_t hash) const {
+		return this->buckets[hash & this->mask];
+	}
+
+public:
+	explicit TranspositionTable(size_t size_mb = 0) :mask(0), generation(1) {
+		resize(size_mb);
+	}
+
+	// size_mb に収まる最大の 2 のべき乗個のバケットを取る。0 なら表を使わない
+	void resize(size_t size_mb) {
+		size_t count = 0;
+		if (size_mb > 0) {
+			count = 1;
+			while (count * 2 * sizeof(Bucket) <= (size_mb << 20))count *= 2;
+		}
+		this->buckets.reset(count > 0 ? new Bucket[count] : nullptr);
+		this->mask = count > 0 ? count - 1 : 0;
+		clear();
+	}
+
+	bool enabled() const {
+		return this->buckets != nullptr;
+	}
+
+	size_t memory_usage() const {
+		return enabled() ? (this->mask + 1) * sizeof(Bucket) : 0;
+	}
+
+	void clear() {
+		if (!enabled())return;
+		for (uint64_t i = 0; i <= this->mask; i++) {
+			for (TTEntry& entry : this->buckets[i].entries) {
+				entry.key.store(0, std::memory_order_relaxed);
+				entry.w.store(0, std::memory_order_relaxed);
+				entry.n.store(0, std::memory_order_relaxed);
+			}
+		}
+		this->generation = 1;
+	}
+
+	// 探索を始めるたびに呼ぶ。前の探索の項目も引けるが、置き換えでは先に捨てられる
+	void new_search() {
+		this->generation = this->generation == GENERATION_MASK ? 1 : this->generation + 1;
+	}
+
+	const TTEntry* find(uint64_t hash) const {
+		for (const TTEntry& entry : bucket(hash).entries) {
+			if (matches(entry.key.load(std::memory_order_acquire), hash))return &entry;
+		}
+		return nullptr;
+	}
+
+	// なければ 空き < 前の探索の項目 < 訪問回数の少ない項目 の順で置き換える。他のスレッドと取り合って負けたら nullptr
+	TTEntry* insert(uint64_t hash) {
+		TTEntry* victim = nullptr;
+		uint64_t victim_key = 0, victim_score = UINT64_MAX;
+		for (TTEntry& entry : bucket(hash).entries) {
+			uint64_t key = entry.key.load(std::memory_order_acquire);
+			bool current = (key & GENERATION_MASK) == this->generation;
+			if (matches(key, hash)) {
+				if (!current)entry.key.compare_exchange_strong(key, make_key(hash), std::memory_order_relaxed);
+				return &entry;
+			}
+			uint64_t score = key == 0 ? 0 : (current ? 1ULL << 32 : 1) + (uint32_t)entry.n.load(std::memory_order_relaxed);
+			if (score < victim_score) {
+				victim = &entry;
+				victim_key = key;
+				victim_score = score;
+			}
+		}
+		if (!victim->key.compare_exchange_strong(victim_key, make_key(hash), std::memory_order_acq_rel))return nullptr;
+		victim->w.store(0, std::memory_order_relaxed);
+		victim->n.store(0, std::memory_order_relaxed);
+		return victim;
+	}
+
+	void update(uint64_t hash, int value) {
+		if (TTEntry* entry = insert(hash)) {
+			entry->w.fetch_add(value, std::memory_order_relaxed);
+			entry->n.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+};
\ No newline at end of file
@@ -0,0 +1,49 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "Bitboard.cpp"
+
+// 局面のハッシュ。石ごとの乱数の xor に、白番とパスによる終局の乱数を混ぜる
+// SimpleState は石を置く・返すたびに差分で更新する
+namespace zobrist {
+	struct Keys {
+		uint64_t stone[2][bitboard::CELLS]; // [色][マス]、色は 0 が黒
+		uint64_t flip[bitboard::CELLS];     // そのマスの石を裏返すときの差分
+		uint64_t side;
+		uint64_t pass_end;
+	};
+
+	constexpr uint64_t splitmix64(uint64_t& x) {
+		uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	constexpr Keys make_keys() {
+		Keys keys = {};
+		uint64_t seed = 0x5eed0f2e7e25ULL;
+		for (int color = 0; color < 2; color++) {
+			for (int pos = 0; pos < bitboard::CELLS; pos++) {
+				keys.stone[color][pos] = splitmix64(seed);
+			}
+		}
+		for (int pos = 0; pos < bitboard::CELLS; pos++) {
+			keys.flip[pos] = keys.stone[0][pos] ^ keys.stone[1][pos];
+		}
+		keys.side = splitmix64(seed);
+		keys.pass_end = splitmix64(seed);
+		return keys;
+	}
+
+	inline constexpr Keys KEYS = make_keys();
+
+	// 差分更新を使わずに一から計算する。color は player 側の色
+	inline uint64_t compute(uint64_t player, uint64_t opponent, int color, bool pass_end) {
+		uint64_t hash = 0;
+		for (uint64_t b = player; b; b &= b - 1)hash ^= KEYS.stone[color][bitboard::lsb(b)];
+		for (uint64_t b = opponent; b; b &= b - 1)hash ^= KEYS.stone[!color][bitboard::lsb(b)];
+		if (color == 1)hash ^= KEYS.side;
+		if (pass_end)hash ^= KEYS.pass_end;
+		return hash;
+	}
+}
\ No newline at end of file
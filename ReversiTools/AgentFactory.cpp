@@ -0,0 +1,102 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "Agent.cpp"
+#include <sstream>
+
+const char* const AGENT_USAGE =
+	"  agent spec: name[:key=value,...]\n"
+	"    names: random, mc, mcts, mcts-root, ab, puct\n"
+	"    keys:  threads (default 1), iterations (ab: depth), time (ms per move), clock (ms per game),\n"
+	"           solve / exact (empties for win-loss-draw / exact endgame solving, 0 disables),\n"
+	"           tt (mcts only: transposition table MB, default 0 = off),\n"
+	"           cutoff (mcts only: plies before a playout is scored by the pattern evaluator),\n"
+	"           batch (mcts only: leaves collected and evaluated together per thread),\n"
+	"           leaf (mcts only: playout, or pattern to score leaves without playouts),\n"
+	"           nodes (mcts only: node cap of the search tree),\n"
+	"           prune (mcts only: fraction of the cap kept when the tree is full, 0 stops expanding instead),\n"
+	"           rave (mcts only: 1 mixes all-moves-as-first statistics into the child selection),\n"
+	"           widen (mcts only: 1 orders children corners first and widens them with the visits),\n"
+	"           pattern (ab only: 0 uses the hand-written evaluator instead of the pattern weights),\n"
+	"           book (0 ignores the opening book)\n";
+
+// "mcts:iterations=1000,threads=2" のような指定からエージェントを作る。解釈できなければ nullptr
+inline std::unique_ptr<Agent> make_agent(const std::string& spec) {
+	std::string name = spec.substr(0, spec.find(':'));
+	int threads = 1;
+	int table_mb = -1;
+	int solve_empties = -1, exact_empties = -1;
+	int cutoff = -1, use_patterns = 1, use_book = 1, batch_size = -1;
+	double node_limit = -1, prune_keep = -1;
+	int rave = 0, widen = 0;
+	std::string leaf = "playout";
+	SearchLimits overrides;
+	if (name.size() < spec.size()) {
+		std::stringstream ss(spec.substr(name.size() + 1));
+		std::string option;
+		while (std::getline(ss, option, ',')) {
+			size_t eq = option.find('=');
+			if (eq == std::string::npos)return nullptr;
+			std::string key = option.substr(0, eq);
+			double value = std::atof(option.c_str() + eq + 1);
+			if (key == "threads")threads = (int)value;
+			else if (key == "iterations")overrides.iterations = (int)value;
+			else if (key == "time")overrides.move_time_ms = value;
+			else if (key == "clock")overrides.game_time_ms = value;
+			else if (key == "tt")table_mb = (int)value;
+			else if (key == "solve")solve_empties = (int)value;
+			else if (key == "exact")exact_empties = (int)value;
+			else if (key == "cutoff")cutoff = (int)value;
+			else if (key == "pattern")use_patterns = (int)value;
+			else if (key == "book")use_book = (int)value;
+			else if (key == "batch")batch_size = (int)value;
+			else if (key == "nodes")node_limit = value;
+			else if (key == "prune")prune_keep = value;
+			else if (key == "rave")rave = (int)value;
+			else if (key == "widen")widen = (int)value;
+			else if (key == "leaf")leaf = option.substr(eq + 1);
+			else return nullptr;
+		}
+	}
+
+	std::unique_ptr<Agent> agent;
+	if (name == "random")agent = std::make_unique<RandomAgent>();
+	else if (name == "mc")agent = std::make_unique<MonteCalroAgent>(threads);
+	else if (name == "mcts" || name == "mcts-root") {
+		auto tree_agent = std::make_unique<MonteCalroTreeAgent>(threads, name == "mcts" ? ParallelMode::Tree : ParallelMode::Root);
+		if (table_mb >= 0)tree_agent->set_table_size(table_mb);
+		if (cutoff >= 0)tree_agent->set_playout_cutoff(PatternEvaluator::shared(), cutoff);
+		if (batch_size > 0)tree_agent->set_batch_size(batch_size);
+		if (node_limit > 0)tree_agent->set_node_limit((uint32_t)std::min<double>(node_limit, UINT32_MAX / 2));
+		if (prune_keep >= 0)tree_agent->set_prune_keep(prune_keep);
+		tree_agent->set_rave(rave != 0);
+		tree_agent->set_progressive_widening(widen != 0);
+		if (leaf == "pattern") {
+			if (!PatternEvaluator::shared())return nullptr;
+			tree_agent->set_leaf_evaluator(std::make_shared<PatternLeafEvaluator>(PatternEvaluator::shared()));
+		}
+		else if (leaf != "playout")return nullptr;
+		agent = std::move(tree_agent);
+	}
+	else if (name == "puct")agent = std::make_unique<PuctAgent>();
+	else if (name == "ab") {
+		auto alpha_beta = std::make_unique<AlphaBetaAgent>();
+		if (!use_patterns)alpha_beta->set_pattern_evaluator(nullptr);
+		agent = std::move(alpha_beta);
+	}
+	else return nullptr;
+
+	if (!use_book)agent->set_opening_book(nullptr);
+	if (solve_empties >= 0 || exact_empties >= 0) {
+		int wld = solve_empties >= 0 ? solve_empties : ENDGAME_WLD_EMPTIES;
+		int exact = exact_empties >= 0 ? exact_empties : std::min(solve_empties, ENDGAME_EXACT_EMPTIES);
+		agent->set_endgame_empties(std::max(wld, exact), exact);
+	}
+	// 時間だけ指定されたら、既定の回数では打ち切らず時間いっぱい読む
+	SearchLimits limits = agent->get_limits();
+	bool timed = overrides.move_time_ms > 0 || overrides.game_time_ms > 0;
+	if (overrides.iterations > 0 || timed)limits.iterations = overrides.iterations;
+	if (overrides.move_time_ms > 0)limits.move_time_ms = overrides.move_time_ms;
+	if (overrides.game_time_ms > 0)limits.game_time_ms = overrides.game_time_ms;
+	agent->set_limits(limits);
+	return agent;
+}
\ No newline at end of file
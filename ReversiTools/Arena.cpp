@@ -0,0 +1,142 @@
+﻿// Siv3D なしで 2 つのエージェントを対局させ、勝率と Elo 差を出す
+#include "EngineDefine.h"
+#include "AgentFactory.cpp"
+#include "SelfPlay.cpp"
+#include "GameRecord.cpp"
+#include <cstdio>
+#include <mutex>
+
+struct ArenaStats {
+	int wins = 0, draws = 0, losses = 0; // A から見た結果
+	double think_ms[2] = {};             // [0] が A、[1] が B
+	int move_count[2] = {};
+
+	int games() const {
+		return wins + draws + losses;
+	}
+};
+
+static void usage() {
+	std::fprintf(stderr,
+		"usage: arena [--games N] [--threads N] [--weights FILE] [--book FILE] [--net FILE] [--trace FILE] [--record FILE] AGENT_A AGENT_B\n"
+		"  --games    number of games, colors alternate (default 100)\n"
+		"  --threads  games played in parallel (default 1)\n"
+		"  --weights  pattern weight file (default %s)\n"
+		"  --book     opening book, \"\" for none (default %s)\n"
+		"  --net      policy/value network for puct (default %s)\n"
+		"  --trace    append one JSON line per move with the search stats\n"
+		"  --record   append the games to a game record file\n%s", PATTERN_WEIGHT_FILE, OPENING_BOOK_FILE, NET_WEIGHT_FILE, AGENT_USAGE);
+}
+
+// 引き分けを半勝として Elo 差と 95% 信頼区間を出す
+static void print_elo(const ArenaStats& stats) {
+	double n = stats.games();
+	double score = (stats.wins + 0.5 * stats.draws) / n;
+	double variance = (stats.wins * std::pow(1 - score, 2) + stats.draws * std::pow(0.5 - score, 2) + stats.losses * std::pow(score, 2)) / n;
+	double margin = 1.96 * std::sqrt(variance / n);
+	auto elo = [](double s) {
+		s = std::clamp(s, 1e-6, 1 - 1e-6);
+		return -400 * std::log10(1 / s - 1);
+	};
+	std::printf("score   %.1f%%\n", score * 100);
+	std::printf("elo     %+.1f (95%% CI %+.1f .. %+.1f)\n", elo(score), elo(score - margin), elo(score + margin));
+}
+
+int main(int argc, char** argv) {
+	int games = 100, threads = 1;
+	std::string weights = PATTERN_WEIGHT_FILE, book_path = OPENING_BOOK_FILE, net_path = NET_WEIGHT_FILE, trace_path, record_path;
+	std::vector<std::string> specs;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--games" && i + 1 < argc)games = std::atoi(argv[++i]);
+		else if (arg == "--threads" && i + 1 < argc)threads = std::atoi(argv[++i]);
+		else if (arg == "--weights" && i + 1 < argc)weights = argv[++i];
+		else if (arg == "--book" && i + 1 < argc)book_path = argv[++i];
+		else if (arg == "--net" && i + 1 < argc)net_path = argv[++i];
+		else if (arg == "--trace" && i + 1 < argc)trace_path = argv[++i];
+		else if (arg == "--record" && i + 1 < argc)record_path = argv[++i];
+		else if (arg.rfind("--", 0) == 0) {
+			usage();
+			return 1;
+		}
+		else specs.push_back(arg);
+	}
+	if (specs.size() != 2 || games <= 0 || threads <= 0) {
+		usage();
+		return 1;
+	}
+	// ここで決めたファイルをエージェントも使う。別のファイルに決まった後なら nullptr が返る
+	if (!PatternEvaluator::shared(weights)) {
+		std::fprintf(stderr, "pattern weights not loaded (%s)\n", weights.c_str());
+	}
+	if (!OpeningBook::shared(book_path) && !book_path.empty()) {
+		std::fprintf(stderr, "opening book not loaded (%s)\n", book_path.c_str());
+	}
+	if (!PolicyValueNet::shared(net_path)) {
+		std::fprintf(stderr, "network not loaded (%s)\n", net_path.c_str());
+	}
+	for (auto& spec : specs) {
+		if (!make_agent(spec)) {
+			std::fprintf(stderr, "unknown agent: %s\n", spec.c_str());
+			usage();
+			return 1;
+		}
+	}
+
+	SearchTrace trace;
+	if (!trace_path.empty() && !trace.open(trace_path)) {
+		std::fprintf(stderr, "cannot open %s\n", trace_path.c_str());
+		return 1;
+	}
+	RecordWriter writer;
+	if (!record_path.empty() && !writer.open(record_path)) {
+		std::fprintf(stderr, "cannot open %s\n", record_path.c_str());
+		return 1;
+	}
+
+	ArenaStats stats;
+	std::mutex mutex;
+	std::atomic<int> next_game = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	// スレッドごとにエージェントを作り、対局をまたいで使い回す
+	auto worker = [&]() {
+		auto a = make_agent(specs[0]), b = make_agent(specs[1]);
+		for (int game; (game = next_game.fetch_add(1)) < games;) {
+			bool a_black = game % 2 == 0;
+			SearchTrace* game_trace = trace.is_open() ? &trace : nullptr;
+			GameResult result = a_black ? play_game(*a, *b, game_trace, game) : play_game(*b, *a, game_trace, game);
+			int a_color = a_black ? 0 : 1;
+			int a_discs = a_black ? result.black : result.white;
+			int b_discs = a_black ? result.white : result.black;
+			if (writer.is_open()) {
+				const std::string& black = specs[a_black ? 0 : 1], & white = specs[a_black ? 1 : 0];
+				writer.write({ black, white, 0, result.black, result.white, result.moves });
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (a_discs > b_discs)stats.wins++;
+			else if (a_discs < b_discs)stats.losses++;
+			else stats.draws++;
+			for (int side = 0; side < 2; side++) {
+				int color = side == 0 ? a_color : !a_color;
+				stats.think_ms[side] += result.think_ms[color];
+				stats.move_count[side] += result.move_count[color];
+			}
+		}
+	};
+	std::vector<std::thread> pool;
+	for (int i = 1; i < threads; i++)pool.emplace_back(worker);
+	worker();
+	for (auto& thread : pool)thread.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::printf("%s vs %s, %d games\n", specs[0].c_str(), specs[1].c_str(), stats.games());
+	std::printf("w/d/l   %d / %d / %d\n", stats.wins, stats.draws, stats.losses);
+	print_elo(stats);
+	std::printf("speed   %.2f games/s\n", stats.games() / seconds);
+	for (int side = 0; side < 2; side++) {
+		std::printf("move    %s %.2f ms\n", specs[side].c_str(), stats.think_ms[side] / std::max(1, stats.move_count[side]));
+	}
+	return 0;
+}
\ No newline at end of file
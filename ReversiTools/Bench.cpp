@@ -0,0 +1,352 @@
+﻿// エンジンの速度を測って JSON で出す。--compare で前の結果と比べ、遅くなった項目があれば失敗にする
+#include "EngineDefine.h"
+#include "AgentFactory.cpp"
+#include "SelfPlay.cpp"
+#include "SizedBoard.cpp"
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+// 計測中の new の回数
+static std::atomic<uint64_t> allocation_count = 0;
+
+void* operator new(size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1))return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	std::free(p);
+}
+
+struct BenchResult {
+	std::string name;
+	std::string unit;
+	uint64_t ops = 0;
+	double seconds = 0;
+	uint64_t allocations = 0;
+	bool ok = true;
+
+	double ops_per_sec() const {
+		return seconds > 0 ? ops / seconds : 0;
+	}
+
+	double allocs_per_op() const {
+		return ops > 0 ? (double)allocations / ops : 0;
+	}
+};
+
+// f は処理した単位の数を返す
+template<class F>
+static BenchResult measure(const std::string& name, const std::string& unit, F f) {
+	BenchResult result;
+	result.name = name;
+	result.unit = unit;
+	uint64_t allocations = allocation_count.load();
+	auto start = std::chrono::steady_clock::now();
+	result.ops = f();
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.allocations = allocation_count.load() - allocations;
+	std::fprintf(stderr, "%-24s %14.0f %s/s %8.3f allocs/%s\n", name.c_str(), result.ops_per_sec(), unit.c_str(), result.allocs_per_op(), unit.c_str());
+	return result;
+}
+
+// SimpleState の legal_actions と next だけで数える perft。数え方は bitboard::perft と同じ
+template <int N>
+static uint64_t sized_perft(int depth) {
+	return sized::perft<N>(sized::Geometry<N>::INITIAL_PLAYER, sized::Geometry<N>::INITIAL_OPPONENT, depth);
+}
+
+static uint64_t state_perft(const SimpleState& state, int depth) {
+	if (depth == 0 || state.is_done())return 1;
+	auto legal_actions = state.legal_actions();
+	if (legal_actions.size() > 1)legal_actions.pop_back();
+	uint64_t count = 0;
+	for (auto& action : legal_actions) {
+		count += state_perft(state.next(action), depth - 1);
+	}
+	return count;
+}
+
+// 1 つの SimpleState を make_move / unmake_move で行き来する perft
+static uint64_t make_unmake_perft(SimpleState& state, int depth) {
+	if (depth == 0 || state.is_done())return 1;
+	uint64_t moves = state.legal_moves();
+	if (!moves) {
+		MoveUndo undo = state.make_move(bitboard::PASS);
+		uint64_t count = make_unmake_perft(state, depth - 1);
+		state.unmake_move(undo);
+		return count;
+	}
+	uint64_t count = 0;
+	for (; moves; moves &= moves - 1) {
+		MoveUndo undo = state.make_move(bitboard::lsb(moves));
+		count += make_unmake_perft(state, depth - 1);
+		state.unmake_move(undo);
+	}
+	return count;
+}
+
+// 計測に使う局面。決まった乱数で打ち進め、empties が 0 なら序盤から終盤まで、そうでなければ空きがその数の局面を取る
+static std::vector<SimpleState> sample_positions(int count, int empties = 0) {
+	std::vector<SimpleState> positions;
+	Xoshiro256 rng(20240101);
+	while ((int)positions.size() < count) {
+		SimpleState state = initial_state();
+		int stop_at = empties > 0 ? bitboard::CELLS : 8 + (int)rng.bounded(44);
+		while (!state.is_done() && state.get_depth() < stop_at && state.empty_count() > empties) {
+			uint64_t moves = state.legal_moves();
+			if (moves == 0) {
+				state = state.next(bitboard::PASS);
+				continue;
+			}
+			for (uint32_t k = rng.bounded(bitboard::popcount(moves)); k; k--)moves &= moves - 1;
+			state = state.next(bitboard::lsb(moves));
+		}
+		if (!state.is_done() && bitboard::popcount(state.legal_moves()) > 1)positions.push_back(state);
+	}
+	return positions;
+}
+
+// 1 行 1 項目で書くので、--compare は自分の出力を行ごとに読めばよい
+static void write_json(std::FILE* out, const std::string& label, const std::vector<BenchResult>& results) {
+	std::fprintf(out, "{\n  \"label\": \"%s\",\n  \"kernel\": \"%s\",\n  \"results\": [\n", label.c_str(), bitboard::kernel.name);
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchResult& r = results[i];
+		std::fprintf(out, "    {\"name\": \"%s\", \"unit\": \"%s\", \"ops\": %llu, \"seconds\": %.6f, \"ops_per_sec\": %.1f, \"allocs_per_op\": %.4f, \"ok\": %s}%s\n",
+			r.name.c_str(), r.unit.c_str(), (unsigned long long)r.ops, r.seconds, r.ops_per_sec(), r.allocs_per_op(), r.ok ? "true" : "false", i + 1 < results.size() ? "," : "");
+	}
+	std::fprintf(out, "  ]\n}\n");
+}
+
+static std::string json_string(const std::string& line, const std::string& key) {
+	size_t at = line.find("\"" + key + "\": \"");
+	if (at == std::string::npos)return "";
+	at += key.size() + 5;
+	return line.substr(at, line.find('"', at) - at);
+}
+
+static double json_number(const std::string& line, const std::string& key) {
+	size_t at = line.find("\"" + key + "\": ");
+	if (at == std::string::npos)return -1;
+	return std::atof(line.c_str() + at + key.size() + 4);
+}
+
+// 前の結果より tolerance 以上遅いか、1 回あたりの new が増えた項目を数える
+static int compare(const std::string& path, const std::vector<BenchResult>& results, double tolerance) {
+	std::ifstream in(path);
+	if (!in) {
+		std::fprintf(stderr, "cannot open %s\n", path.c_str());
+		return -1;
+	}
+	std::map<std::string, std::pair<double, double>> baseline;
+	for (std::string line; std::getline(in, line);) {
+		std::string name = json_string(line, "name");
+		if (!name.empty())baseline[name] = { json_number(line, "ops_per_sec"), json_number(line, "allocs_per_op") };
+	}
+	int regressions = 0;
+	for (const BenchResult& r : results) {
+		auto it = baseline.find(r.name);
+		if (it == baseline.end() || it->second.first <= 0)continue;
+		double ratio = r.ops_per_sec() / it->second.first;
+		bool slower = ratio < 1 - tolerance;
+		bool more_allocs = r.allocs_per_op() > it->second.second + 1e-3;
+		std::fprintf(stderr, "%-24s x%.3f%s%s\n", r.name.c_str(), ratio, slower ? "  SLOWER" : "", more_allocs ? "  MORE ALLOCS" : "");
+		regressions += slower || more_allocs || !r.ok;
+	}
+	return regressions;
+}
+
+// --threads の掃引から、木の共有とルート並列それぞれの 1 スレッドに対する伸びを表にする。ルート並列の 1 スレッドは共有と同じ探索になる
+static void print_scaling(const std::vector<BenchResult>& results, const std::vector<int>& thread_counts) {
+	auto rate = [&](const std::string& name) {
+		for (auto& r : results)if (r.name == name)return r.ops_per_sec();
+		return 0.0;
+	};
+	double base = rate("mcts.t1");
+	if (base <= 0)return;
+	std::fprintf(stderr, "%-8s %14s %8s %14s %8s\n", "threads", "tree", "speedup", "root", "speedup");
+	for (int threads : thread_counts) {
+		std::string suffix = ".t" + std::to_string(threads);
+		double tree = rate("mcts" + suffix);
+		double root = threads > 1 ? rate("mcts_root" + suffix) : tree;
+		std::fprintf(stderr, "%-8d %14.0f %7.2fx %14.0f %7.2fx\n", threads, tree, tree / base, root, root / base);
+	}
+}
+
+static void usage() {
+	std::fprintf(stderr,
+		"usage: bench [options]\n"
+		"  --perft-depth N     perft depth from the start position, up to 10 (default 9)\n"
+		"  --playouts N        playouts for the playout benchmark (default 200000)\n"
+		"  --positions N       positions searched per agent benchmark (default 16)\n"
+		"  --iterations N      playouts or tree iterations per agent move (default 20000)\n"
+		"  --threads LIST      agent thread counts to sweep, e.g. 1,2,4, or all for 1,2,4,... up to the hardware threads (default 1)\n"
+		"  --batch N           also measure mcts with N leaves evaluated per batch (default 1)\n"
+		"  --endgame N         empties of the positions given to the endgame solver (default 14)\n"
+		"  --label TEXT        stored in the JSON to identify the build\n"
+		"  --out FILE          write JSON to FILE instead of stdout\n"
+		"  --compare FILE      compare with an earlier JSON and exit 1 on regressions\n"
+		"  --tolerance X       allowed slowdown for --compare (default 0.1)\n");
+}
+
+int main(int argc, char** argv) {
+	int perft_depth = 9, playouts = 200000, position_count = 16, iterations = 20000, endgame_empties = 14, batch_size = 1;
+	std::vector<int> thread_counts = { 1 };
+	std::string label, out_path, compare_path;
+	double tolerance = 0.1;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			usage();
+			return 1;
+		}
+		std::string value = argv[++i];
+		if (arg == "--perft-depth")perft_depth = std::atoi(value.c_str());
+		else if (arg == "--playouts")playouts = std::atoi(value.c_str());
+		else if (arg == "--positions")position_count = std::atoi(value.c_str());
+		else if (arg == "--iterations")iterations = std::atoi(value.c_str());
+		else if (arg == "--endgame")endgame_empties = std::atoi(value.c_str());
+		else if (arg == "--batch")batch_size = std::atoi(value.c_str());
+		else if (arg == "--label")label = value;
+		else if (arg == "--out")out_path = value;
+		else if (arg == "--compare")compare_path = value;
+		else if (arg == "--tolerance")tolerance = std::atof(value.c_str());
+		else if (arg == "--threads" && value == "all") {
+			thread_counts.clear();
+			int hardware = std::max(1, (int)std::thread::hardware_concurrency());
+			for (int count = 1; count < hardware; count *= 2)thread_counts.push_back(count);
+			thread_counts.push_back(hardware);
+		}
+		else if (arg == "--threads") {
+			thread_counts.clear();
+			std::stringstream ss(value);
+			for (std::string count; std::getline(ss, count, ',');)thread_counts.push_back(std::max(1, std::atoi(count.c_str())));
+		}
+		else {
+			usage();
+			return 1;
+		}
+	}
+	if (perft_depth < 1 || perft_depth >= (int)std::size(bitboard::PERFT_COUNTS) || thread_counts.empty() || endgame_empties < 1) {
+		usage();
+		return 1;
+	}
+
+	std::vector<BenchResult> results;
+
+	std::vector<const bitboard::Kernel*> kernels = { &bitboard::SCALAR_KERNEL };
+#ifdef BITBOARD_X64
+	if (bitboard::cpu_has_avx2())kernels.push_back(&bitboard::AVX2_KERNEL);
+#endif
+	for (auto kernel : kernels) {
+		results.push_back(measure(std::string("perft.") + kernel->name, "node", [&]() {
+			return bitboard::perft(*kernel, bitboard::INITIAL_PLAYER, bitboard::INITIAL_OPPONENT, perft_depth);
+		}));
+		results.back().ok = results.back().ops == bitboard::PERFT_COUNTS[perft_depth];
+	}
+
+	int state_depth = std::min(perft_depth, 8);
+	results.push_back(measure("perft.simple_state", "node", [&]() {
+		return state_perft(initial_state(), state_depth);
+	}));
+	results.back().ok = results.back().ops == bitboard::PERFT_COUNTS[state_depth];
+	results.push_back(measure("perft.make_unmake", "node", [&]() {
+		SimpleState state = initial_state();
+		return make_unmake_perft(state, perft_depth);
+	}));
+	results.back().ok = results.back().ops == bitboard::PERFT_COUNTS[perft_depth];
+
+	// 盤の大きさをテンプレート引数にした経路。8x8 は bitboard のカーネルに落ちる
+	int size6_depth = std::min(perft_depth, (int)std::size(sized::PERFT_COUNTS_6) - 1);
+	int size10_depth = std::min(perft_depth, (int)std::size(sized::PERFT_COUNTS_10) - 1);
+	results.push_back(measure("perft.size6", "node", [&]() { return sized_perft<6>(size6_depth); }));
+	results.back().ok = results.back().ops == sized::PERFT_COUNTS_6[size6_depth];
+	results.push_back(measure("perft.size8", "node", [&]() { return sized_perft<8>(perft_depth); }));
+	results.back().ok = results.back().ops == bitboard::PERFT_COUNTS[perft_depth];
+	results.push_back(measure("perft.size10", "node", [&]() { return sized_perft<10>(size10_depth); }));
+	results.back().ok = results.back().ops == sized::PERFT_COUNTS_10[size10_depth];
+
+	results.push_back(measure("playout", "playout", [&]() {
+		PlayoutEngine engine(1);
+		SimpleState state = initial_state();
+		int sum = 0;
+		for (int i = 0; i < playouts; i++)sum += engine.run(state);
+		return (uint64_t)playouts + (sum > playouts); // 最適化で消されないように結果を使う
+	}));
+
+	// 終盤の完全読みは置換表を毎回空にして、局面ごとに一から読む
+	std::vector<SimpleState> endgame_positions = sample_positions(position_count, endgame_empties);
+	for (SolveMode mode : { SolveMode::WinLossDraw, SolveMode::Exact }) {
+		EndgameSolver solver;
+		results.push_back(measure(mode == SolveMode::Exact ? "endgame.exact" : "endgame.wld", "node", [&]() {
+			uint64_t nodes = 0;
+			for (auto& state : endgame_positions) {
+				solver.clear();
+				nodes += solver.solve(state, mode).nodes;
+			}
+			return nodes;
+		}));
+	}
+
+	// 1 手ごとの探索時間だけを測るため、エージェントの生成は計測に含めない。定跡と終盤の完全読みは切っておく
+	// MCTS はパターン評価のファイルがあるとプレイアウトを途中で打ち切るので、置き場所で測る仕事が変わらないように打ち切りも切る
+	std::vector<SimpleState> positions = sample_positions(position_count);
+	auto plain_tree = [](MonteCalroTreeAgent& agent) {
+		agent.set_endgame_empties(0, 0);
+		agent.set_playout_cutoff(nullptr, 0);
+	};
+	auto agent_bench = [&](const std::string& name, auto& agent) {
+		SearchLimits limits;
+		limits.iterations = iterations;
+		agent.set_limits(limits);
+		agent.set_opening_book(nullptr);
+		results.push_back(measure(name, "playout", [&]() {
+			uint64_t before = agent.get_playout_count();
+			for (auto& state : positions)agent.select_action(state);
+			return agent.get_playout_count() - before;
+		}));
+	};
+	for (int threads : thread_counts) {
+		std::string suffix = ".t" + std::to_string(threads);
+		MonteCalroAgent mc(threads);
+		agent_bench("mc" + suffix, mc);
+		MonteCalroTreeAgent mcts(threads, ParallelMode::Tree);
+		plain_tree(mcts);
+		agent_bench("mcts" + suffix, mcts);
+		if (batch_size != MCTS_BATCH_SIZE) {
+			MonteCalroTreeAgent mcts_batch(threads, ParallelMode::Tree);
+			plain_tree(mcts_batch);
+			mcts_batch.set_batch_size(batch_size);
+			agent_bench("mcts.b" + std::to_string(batch_size) + suffix, mcts_batch);
+		}
+		if (threads > 1) {
+			MonteCalroTreeAgent mcts_root(threads, ParallelMode::Root);
+			plain_tree(mcts_root);
+			agent_bench("mcts_root" + suffix, mcts_root);
+		}
+	}
+	if (thread_counts.size() > 1)print_scaling(results, thread_counts);
+
+	std::FILE* out = out_path.empty() ? stdout : std::fopen(out_path.c_str(), "w");
+	if (!out) {
+		std::fprintf(stderr, "cannot open %s\n", out_path.c_str());
+		return 1;
+	}
+	write_json(out, label, results);
+	if (out != stdout)std::fclose(out);
+
+	bool ok = std::all_of(results.begin(), results.end(), [](const BenchResult& r) { return r.ok; });
+	if (!ok)std::fprintf(stderr, "perft mismatch\n");
+	if (!compare_path.empty()) {
+		int regressions = compare(compare_path, results, tolerance);
+		if (regressions != 0)return 1;
+	}
+	return ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+﻿// 自己対局の勝敗を集計して定跡ファイルを作る。既存の定跡に足していけば、定跡手を打った先の局面へ広がっていく
+#include "EngineDefine.h"
+#include "AgentFactory.cpp"
+#include "SelfPlay.cpp"
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+struct BookStats {
+	uint32_t games = 0;
+	uint32_t points = 0;
+};
+
+static void usage() {
+	std::fprintf(stderr,
+		"usage: build_book [options]\n"
+		"  --games N      self-play games (default 2000)\n"
+		"  --depth N      plies recorded from each game (default 16)\n"
+		"  --epsilon X    probability of a random move within those plies (default 0.25)\n"
+		"  --agent SPEC   agent that plays the games (default ab:iterations=4)\n"
+		"  --threads N    games played in parallel (default 1)\n"
+		"  --init FILE    book to extend; its moves are also played during self-play\n"
+		"  --out FILE     book to write (default %s)\n"
+		"  --min-games N  drop moves played fewer times (default 2)\n"
+		"  --weights FILE pattern weight file (default %s)\n%s", OPENING_BOOK_FILE, PATTERN_WEIGHT_FILE, AGENT_USAGE);
+}
+
+int main(int argc, char** argv) {
+	int games = 2000, depth = 16, threads = 1, min_games = 2;
+	double epsilon = 0.25;
+	std::string spec = "ab:iterations=4", init_path, out_path = OPENING_BOOK_FILE, weights = PATTERN_WEIGHT_FILE;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			usage();
+			return 1;
+		}
+		std::string value = argv[++i];
+		if (arg == "--games")games = std::atoi(value.c_str());
+		else if (arg == "--depth")depth = std::atoi(value.c_str());
+		else if (arg == "--epsilon")epsilon = std::atof(value.c_str());
+		else if (arg == "--agent")spec = value;
+		else if (arg == "--threads")threads = std::atoi(value.c_str());
+		else if (arg == "--init")init_path = value;
+		else if (arg == "--out")out_path = value;
+		else if (arg == "--min-games")min_games = std::atoi(value.c_str());
+		else if (arg == "--weights")weights = value;
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	// エージェントは --init の定跡を使う。無ければ定跡なしで打つ
+	PatternEvaluator::shared(weights);
+	const OpeningBook* init_book = OpeningBook::shared(init_path);
+	if (!init_path.empty() && !init_book) {
+		std::fprintf(stderr, "cannot load %s\n", init_path.c_str());
+		return 1;
+	}
+	if (games <= 0 || threads <= 0 || !make_agent(spec)) {
+		usage();
+		return 1;
+	}
+	std::unordered_map<uint64_t, BookStats> stats;
+	if (init_book) {
+		for (const book::Entry& entry : *init_book) {
+			stats[entry.key] = { entry.games, entry.points };
+		}
+	}
+	size_t initial_entries = stats.size();
+
+	std::mutex mutex;
+	std::atomic<int> next_game = 0;
+	auto start = std::chrono::steady_clock::now();
+	auto worker = [&](int thread_index) {
+		auto agent = make_agent(spec);
+		Xoshiro256 rng{ std::random_device()() + thread_index };
+		std::vector<std::pair<uint64_t, int>> records; // キーと打った側の色
+		while (next_game.fetch_add(1) < games) {
+			records.clear();
+			SearchLimits limits = agent->get_limits();
+			SimpleState state = initial_state();
+			while (!state.is_done()) {
+				uint64_t legal = state.legal_moves();
+				if (!legal) {
+					state = state.next(bitboard::PASS);
+					continue;
+				}
+				int pos;
+				if (state.get_depth() < depth && (rng() >> 11) * 0x1.0p-53 < epsilon) {
+					for (uint32_t k = rng.bounded(bitboard::popcount(legal)); k; k--)legal &= legal - 1;
+					pos = bitboard::lsb(legal);
+				}
+				else {
+					auto action = agent->select_action(state);
+					pos = bitboard::to_pos(action.first, action.second);
+				}
+				if (state.get_depth() < depth) {
+					book::Canonical c = book::canonical(state.get_player(), state.get_opponent());
+					uint64_t move = bitboard::symmetry(bitboard::bit(pos), c.symmetry);
+					records.emplace_back(book::position_key(c) | (uint64_t)bitboard::lsb(move), state.teban());
+				}
+				state = state.next(pos);
+			}
+			agent->set_limits(limits);
+			auto [mine, theirs] = state.stone_count();
+			int black_diff = state.teban() == 0 ? mine - theirs : theirs - mine;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto [key, color] : records) {
+				int diff = color == 0 ? black_diff : -black_diff;
+				BookStats& s = stats[key];
+				s.games++;
+				s.points += diff > 0 ? 2 : (diff == 0 ? 1 : 0);
+			}
+		}
+	};
+	std::vector<std::thread> pool;
+	for (int i = 1; i < threads; i++)pool.emplace_back(worker, i);
+	worker(0);
+	for (auto& thread : pool)thread.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<book::Entry> entries;
+	for (auto& [key, s] : stats) {
+		if (s.games >= (uint32_t)min_games)entries.push_back({ key, s.games, s.points });
+	}
+	std::sort(entries.begin(), entries.end(), [](const book::Entry& a, const book::Entry& b) {
+		return a.key < b.key;
+	});
+	if (!book::write_file(out_path, entries)) {
+		std::fprintf(stderr, "cannot write %s\n", out_path.c_str());
+		return 1;
+	}
+	std::printf("games    %d (%.1f games/s)\n", games, games / seconds);
+	std::printf("moves    %zu seen, %zu new\n", stats.size(), stats.size() - initial_entries);
+	std::printf("written  %zu moves with at least %d games to %s\n", entries.size(), min_games, out_path.c_str());
+	return 0;
+}
\ No newline at end of file
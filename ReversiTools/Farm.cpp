@@ -0,0 +1,307 @@
+﻿// 自己対局を複数のプロセスで回す。親が Unix ドメインソケットで対局を 1 局ずつ割り当て、結果と棋譜をまとめる
+// 子は親を fork して作るので、重みや定跡を写したメモリはすべての子で共有される。落ちた子は作り直し、その対局は別の子に回す
+#include "EngineDefine.h"
+#include "AgentFactory.cpp"
+#include "SelfPlay.cpp"
+#include "GameRecord.cpp"
+#include <csignal>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace farm {
+	constexpr int MAX_MOVES = 128;
+	constexpr int MAX_ATTEMPTS = 3; // 同じ対局で子がこの回数落ちたら、その対局はあきらめる
+	constexpr int REPORT_SECONDS = 10;
+
+	// 親から子へ。game が負なら終了
+	struct Assignment {
+		int32_t game;
+		int32_t a_black;
+	};
+
+	// 子から親へ
+	struct Result {
+		int32_t game;
+		int32_t black;
+		int32_t white;
+		int32_t move_count[2];
+		double think_ms[2];
+		int32_t length;
+		uint8_t moves[MAX_MOVES];
+	};
+
+	// ソケットは途中までしか読み書きできないことがあるので、全部済むまで繰り返す
+	inline bool write_all(int fd, const void* data, size_t size) {
+		const char* p = (const char*)data;
+		while (size > 0) {
+			ssize_t n = ::write(fd, p, size);
+			if (n < 0 && errno == EINTR)continue;
+			if (n <= 0)return false;
+			p += n;
+			size -= (size_t)n;
+		}
+		return true;
+	}
+
+	inline bool read_all(int fd, void* data, size_t size) {
+		char* p = (char*)data;
+		while (size > 0) {
+			ssize_t n = ::read(fd, p, size);
+			if (n < 0 && errno == EINTR)continue;
+			if (n <= 0)return false;
+			p += n;
+			size -= (size_t)n;
+		}
+		return true;
+	}
+
+	// 子の本体。エージェントは最初に 1 度だけ作り、対局をまたいで使い回す
+	[[noreturn]] inline void run_worker(int fd, const std::string& spec_a, const std::string& spec_b) {
+		auto a = make_agent(spec_a), b = make_agent(spec_b);
+		Assignment assignment;
+		while (read_all(fd, &assignment, sizeof(assignment)) && assignment.game >= 0) {
+			GameResult game = assignment.a_black ? play_game(*a, *b) : play_game(*b, *a);
+			Result result = {};
+			result.game = assignment.game;
+			result.black = game.black;
+			result.white = game.white;
+			for (int color = 0; color < 2; color++) {
+				result.move_count[color] = game.move_count[color];
+				result.think_ms[color] = game.think_ms[color];
+			}
+			result.length = (int32_t)std::min<size_t>(game.moves.size(), MAX_MOVES);
+			std::memcpy(result.moves, game.moves.data(), result.length);
+			if (!write_all(fd, &result, sizeof(result)))break;
+		}
+		_exit(0);
+	}
+
+	struct Worker {
+		pid_t pid = -1;
+		int fd = -1;
+		int game = -1; // 割り当て中の対局
+	};
+}
+
+struct FarmStats {
+	int wins = 0, draws = 0, losses = 0; // A から見た結果
+	double think_ms[2] = {};             // [0] が A、[1] が B
+	int move_count[2] = {};
+
+	int games() const {
+		return wins + draws + losses;
+	}
+};
+
+static void usage() {
+	std::fprintf(stderr,
+		"usage: farm [--games N] [--workers N] [--weights FILE] [--book FILE] [--net FILE] [--record FILE] AGENT_A AGENT_B\n"
+		"  --games    number of games, colors alternate (default 100)\n"
+		"  --workers  worker processes (default 1)\n"
+		"  --weights  pattern weight file (default %s)\n"
+		"  --book     opening book, \"\" for none (default %s)\n"
+		"  --net      policy/value network for puct (default %s)\n"
+		"  --record   append the games to a game record file\n%s", PATTERN_WEIGHT_FILE, OPENING_BOOK_FILE, NET_WEIGHT_FILE, AGENT_USAGE);
+}
+
+int main(int argc, char** argv) {
+	int games = 100, worker_count = 1;
+	std::string weights = PATTERN_WEIGHT_FILE, book_path = OPENING_BOOK_FILE, net_path = NET_WEIGHT_FILE, record_path;
+	std::vector<std::string> specs;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--games" && i + 1 < argc)games = std::atoi(argv[++i]);
+		else if (arg == "--workers" && i + 1 < argc)worker_count = std::atoi(argv[++i]);
+		else if (arg == "--weights" && i + 1 < argc)weights = argv[++i];
+		else if (arg == "--book" && i + 1 < argc)book_path = argv[++i];
+		else if (arg == "--net" && i + 1 < argc)net_path = argv[++i];
+		else if (arg == "--record" && i + 1 < argc)record_path = argv[++i];
+		else if (arg.rfind("--", 0) == 0) {
+			usage();
+			return 1;
+		}
+		else specs.push_back(arg);
+	}
+	if (specs.size() != 2 || games <= 0 || worker_count <= 0) {
+		usage();
+		return 1;
+	}
+	// fork より先に読んでおけば、子はこの写しをそのまま使う
+	if (!PatternEvaluator::shared(weights)) {
+		std::fprintf(stderr, "pattern weights not loaded (%s)\n", weights.c_str());
+	}
+	if (!OpeningBook::shared(book_path) && !book_path.empty()) {
+		std::fprintf(stderr, "opening book not loaded (%s)\n", book_path.c_str());
+	}
+	if (!PolicyValueNet::shared(net_path)) {
+		std::fprintf(stderr, "network not loaded (%s)\n", net_path.c_str());
+	}
+	for (auto& spec : specs) {
+		if (!make_agent(spec)) {
+			std::fprintf(stderr, "unknown agent: %s\n", spec.c_str());
+			usage();
+			return 1;
+		}
+	}
+	RecordWriter writer;
+	if (!record_path.empty() && !writer.open(record_path)) {
+		std::fprintf(stderr, "cannot open %s\n", record_path.c_str());
+		return 1;
+	}
+	// 落ちた子へ書いたときに親ごと止まらないようにする
+	std::signal(SIGPIPE, SIG_IGN);
+
+	std::vector<farm::Worker> workers(worker_count);
+	std::deque<int> pending; // 落ちた子から戻ってきた対局
+	std::vector<int> attempts(games);
+	int next_game = 0, failed = 0, restarts = 0;
+	FarmStats stats;
+
+	auto spawn = [&](farm::Worker& worker) {
+		int fds[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)return false;
+		std::fflush(nullptr);
+		pid_t pid = fork();
+		if (pid < 0) {
+			::close(fds[0]);
+			::close(fds[1]);
+			return false;
+		}
+		if (pid == 0) {
+			::close(fds[0]);
+			for (auto& other : workers) {
+				if (other.fd >= 0)::close(other.fd);
+			}
+			farm::run_worker(fds[1], specs[0], specs[1]);
+		}
+		::close(fds[1]);
+		worker.pid = pid;
+		worker.fd = fds[0];
+		worker.game = -1;
+		return true;
+	};
+	// 次の対局を渡す。残りがなければ終わらせる
+	auto assign = [&](farm::Worker& worker) {
+		int game = -1;
+		if (!pending.empty()) {
+			game = pending.front();
+			pending.pop_front();
+		}
+		else if (next_game < games) {
+			game = next_game++;
+		}
+		farm::Assignment assignment = { game, game % 2 == 0 };
+		worker.game = game;
+		return farm::write_all(worker.fd, &assignment, sizeof(assignment));
+	};
+	auto retire = [&](farm::Worker& worker) {
+		::close(worker.fd);
+		int status = 0;
+		waitpid(worker.pid, &status, 0);
+		worker.fd = -1;
+		worker.pid = -1;
+		return status;
+	};
+	std::function<void(farm::Worker&)> crashed = [&](farm::Worker& worker) {
+		int game = worker.game;
+		int status = retire(worker);
+		if (WIFSIGNALED(status))std::fprintf(stderr, "worker exited by signal %d", WTERMSIG(status));
+		else std::fprintf(stderr, "worker exited with status %d", WEXITSTATUS(status));
+		if (game >= 0 && ++attempts[game] >= farm::MAX_ATTEMPTS) {
+			std::fprintf(stderr, ", giving up on game %d\n", game);
+			failed++;
+		}
+		else {
+			if (game >= 0)pending.push_front(game);
+			std::fprintf(stderr, ", restarting\n");
+		}
+		if (pending.empty() && next_game >= games)return;
+		restarts++;
+		if (!spawn(worker)) {
+			std::fprintf(stderr, "cannot start a worker\n");
+			return;
+		}
+		if (!assign(worker))crashed(worker);
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	auto last_report = start;
+	for (auto& worker : workers) {
+		if (!spawn(worker)) {
+			std::fprintf(stderr, "cannot start a worker\n");
+			return 1;
+		}
+		// 対局数より子が多ければ、仕事のない子はすぐに終わらせる
+		bool sent = assign(worker);
+		if (worker.game < 0)retire(worker);
+		else if (!sent)crashed(worker);
+	}
+
+	std::vector<pollfd> fds;
+	std::vector<farm::Worker*> polled;
+	while (true) {
+		fds.clear();
+		polled.clear();
+		for (auto& worker : workers) {
+			if (worker.fd < 0)continue;
+			fds.push_back({ worker.fd, POLLIN, 0 });
+			polled.push_back(&worker);
+		}
+		if (fds.empty())break;
+		if (poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR)continue;
+			std::perror("poll");
+			return 1;
+		}
+		for (size_t i = 0; i < fds.size(); i++) {
+			if (!fds[i].revents)continue;
+			farm::Worker& worker = *polled[i];
+			farm::Result result;
+			if (!farm::read_all(worker.fd, &result, sizeof(result)) || result.game != worker.game) {
+				crashed(worker);
+				continue;
+			}
+			bool a_black = result.game % 2 == 0;
+			int a_discs = a_black ? result.black : result.white;
+			int b_discs = a_black ? result.white : result.black;
+			if (a_discs > b_discs)stats.wins++;
+			else if (a_discs < b_discs)stats.losses++;
+			else stats.draws++;
+			for (int side = 0; side < 2; side++) {
+				int color = side == 0 ? !a_black : a_black;
+				stats.think_ms[side] += result.think_ms[color];
+				stats.move_count[side] += result.move_count[color];
+			}
+			if (writer.is_open()) {
+				std::vector<uint8_t> moves(result.moves, result.moves + result.length);
+				writer.write({ specs[a_black ? 0 : 1], specs[a_black ? 1 : 0], 0, result.black, result.white, moves });
+			}
+			bool sent = assign(worker);
+			if (worker.game < 0)retire(worker);
+			else if (!sent)crashed(worker);
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		if (now - last_report >= std::chrono::seconds(farm::REPORT_SECONDS)) {
+			double hours = std::chrono::duration<double>(now - start).count() / 3600;
+			std::fprintf(stderr, "%d / %d games, %.0f games/h\n", stats.games(), games, stats.games() / hours);
+			writer.flush();
+			last_report = now;
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::printf("%s vs %s, %d games, %d workers\n", specs[0].c_str(), specs[1].c_str(), stats.games(), worker_count);
+	std::printf("w/d/l   %d / %d / %d\n", stats.wins, stats.draws, stats.losses);
+	if (restarts || failed)std::printf("workers %d restarts, %d games lost\n", restarts, failed);
+	std::printf("speed   %.0f games/h\n", stats.games() / seconds * 3600);
+	for (int side = 0; side < 2; side++) {
+		std::printf("move    %s %.2f ms\n", specs[side].c_str(), stats.think_ms[side] / std::max(1, stats.move_count[side]));
+	}
+	return 0;
+}
\ No newline at end of file
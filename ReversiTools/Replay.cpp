@@ -0,0 +1,114 @@
+﻿// 棋譜ファイルの集計・検証と、1 局分の局面の表示
+#include "EngineDefine.h"
+#include "GameRecord.cpp"
+#include <chrono>
+#include <cstdio>
+#include <map>
+
+static void usage() {
+	std::fprintf(stderr,
+		"usage: replay [--verify] [--show N] FILE\n"
+		"  --verify  replay every game and check the moves and the final discs\n"
+		"  --show N  print the positions of game N (0-based)\n");
+}
+
+static std::string move_name(int pos) {
+	if (pos == bitboard::PASS)return "pass";
+	return { (char)('a' + pos % bitboard::SIZE), (char)('1' + pos / bitboard::SIZE) };
+}
+
+static void print_state(const SimpleState& state) {
+	for (int y = 0; y < bitboard::SIZE; y++) {
+		char row[bitboard::SIZE + 1] = {};
+		for (int x = 0; x < bitboard::SIZE; x++) {
+			int color = state.getColor(y, x);
+			row[x] = color == 0 ? 'X' : color == 1 ? 'O' : '.';
+		}
+		std::printf("  %s\n", row);
+	}
+}
+
+static void show(const RecordReader& reader, size_t index) {
+	RecordReader::Game g = reader.game(index);
+	std::printf("game %zu: %s (X) vs %s (O), seed %llu, %d moves, %d-%d\n", index, g.black->c_str(), g.white->c_str(),
+		(unsigned long long)g.seed, g.move_count, g.black_discs, g.white_discs);
+	SimpleState last;
+	int ply = 0;
+	bool ok = reader.replay(index, [&](const SimpleState& state, int pos, bool random) {
+		std::printf("%d. %s %s%s\n", ++ply, state.teban() == 0 ? "X" : "O", move_name(pos).c_str(), random ? " (random)" : "");
+		print_state(state);
+		last = state.next(pos);
+	});
+	if (ply > 0) {
+		std::printf("final\n");
+		print_state(last);
+	}
+	if (!ok)std::printf("record does not replay cleanly\n");
+}
+
+int main(int argc, char** argv) {
+	bool verify = false;
+	long long show_index = -1;
+	std::string path;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--verify")verify = true;
+		else if (arg == "--show" && i + 1 < argc)show_index = std::atoll(argv[++i]);
+		else if (arg.rfind("--", 0) == 0 || !path.empty()) {
+			usage();
+			return 1;
+		}
+		else path = arg;
+	}
+	if (path.empty()) {
+		usage();
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	RecordReader reader;
+	if (!reader.load(path)) {
+		std::fprintf(stderr, "cannot read %s\n", path.c_str());
+		return 1;
+	}
+	double index_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (show_index >= 0) {
+		if ((size_t)show_index >= reader.size()) {
+			std::fprintf(stderr, "game %lld out of range (%zu games)\n", show_index, reader.size());
+			return 1;
+		}
+		show(reader, (size_t)show_index);
+		return 0;
+	}
+
+	// 黒番から見た勝ち・引き分け・負けを、エージェントの組ごとに数える
+	std::map<std::pair<std::string, std::string>, std::array<int, 3>> pairs;
+	size_t moves = 0, random_moves = 0;
+	for (size_t i = 0; i < reader.size(); i++) {
+		RecordReader::Game g = reader.game(i);
+		moves += g.move_count;
+		for (int k = 0; k < g.move_count; k++)random_moves += g.is_random(k);
+		int outcome = g.black_discs > g.white_discs ? 0 : g.black_discs == g.white_discs ? 1 : 2;
+		pairs[{ *g.black, *g.white }][outcome]++;
+	}
+	std::printf("%s: %zu games, %zu moves (%zu random), %zu bytes, indexed in %.1f ms\n", path.c_str(), reader.size(), moves, random_moves,
+		reader.get_valid_size(), index_ms);
+	for (auto& [agents, counts] : pairs) {
+		std::printf("  %s vs %s: %d / %d / %d\n", agents.first.c_str(), agents.second.c_str(), counts[0], counts[1], counts[2]);
+	}
+
+	if (verify) {
+		start = std::chrono::steady_clock::now();
+		size_t bad = 0, positions = 0;
+		for (size_t i = 0; i < reader.size(); i++) {
+			if (!reader.replay(i, [&](const SimpleState&, int, bool) { positions++; })) {
+				if (bad++ < 10)std::printf("  game %zu does not replay cleanly\n", i);
+			}
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::printf("verify  %zu bad, %zu positions in %.2f s\n", bad, positions, seconds);
+		return bad == 0 ? 0 : 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+﻿#pragma once
+#include "EngineDefine.h"
+#include "SimpleState.cpp"
+#include "Agent.cpp"
+#include <chrono>
+
+struct GameResult {
+	int black;
+	int white;
+	std::vector<uint8_t> moves; // 0..63、パスは bitboard::PASS
+	double think_ms[2];         // [0] が黒、[1] が白の思考時間の合計
+	int move_count[2];
+};
+
+inline SimpleState initial_state() {
+	return SimpleState(bitboard::INITIAL_PLAYER, bitboard::INITIAL_OPPONENT, 0);
+}
+
+// 持ち時間は対局ごとに戻す。trace があれば 1 手ごとの探索の記録を書く
+inline GameResult play_game(Agent& black, Agent& white, SearchTrace* trace = nullptr, int game = 0) {
+	GameResult result = {};
+	SearchLimits black_limits = black.get_limits(), white_limits = white.get_limits();
+	SimpleState state = initial_state();
+	while (!state.is_done()) {
+		int color = state.teban();
+		Agent& agent = color == 0 ? black : white;
+		auto start = std::chrono::steady_clock::now();
+		auto action = agent.select_action(state);
+		result.think_ms[color] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (trace)trace->write(agent.get_last_stats(), game);
+		result.move_count[color]++;
+		int pos = action.first < 0 ? bitboard::PASS : bitboard::to_pos(action.first, action.second);
+		result.moves.push_back((uint8_t)pos);
+		state = state.next(pos);
+	}
+	auto [mine, theirs] = state.stone_count();
+	result.black = state.teban() == 0 ? mine : theirs;
+	result.white = state.teban() == 0 ? theirs : mine;
+	black.set_limits(black_limits);
+	white.set_limits(white_limits);
+	return result;
+}
\ No newline at end of file
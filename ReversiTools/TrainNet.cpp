@@ -0,0 +1,437 @@
+﻿// 自己対局の棋譜で方策・評価値ネットを学習し、int8 に量子化して書き出す
+// 方策は対局したエージェントの手、評価値は終局の勝敗を教師にする。学習は推論と同じ形 (0..1 で切る ReLU、重みの範囲) の float で行う
+#include "EngineDefine.h"
+#include "AgentFactory.cpp"
+#include "SelfPlay.cpp"
+#include "GameRecord.cpp"
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+struct NetSample {
+	uint64_t player;
+	uint64_t opponent;
+	uint64_t legal;
+	int move;   // 教師の手。ランダムに打った手なら -1 で方策は学習しない
+	int result; // 手番側から見た 勝ち 1 / 引き分け 0 / 負け -1
+};
+
+// float の重み。並びは net::Weights と同じで、1 本の配列に詰めて Adam でまとめて更新する
+class FloatNet {
+public:
+	static const size_t W1 = 0;
+	static const size_t B1 = W1 + net::INPUTS * net::HIDDEN1;
+	static const size_t W2 = B1 + net::HIDDEN1;
+	static const size_t B2 = W2 + net::HIDDEN2 * net::HIDDEN1;
+	static const size_t PW = B2 + net::HIDDEN2;
+	static const size_t PB = PW + net::POLICY * net::HIDDEN2;
+	static const size_t VW = PB + net::POLICY;
+	static const size_t VB = VW + net::HIDDEN2;
+	static const size_t SIZE = VB + 1;
+
+	std::vector<float> params;
+
+	FloatNet() :params(SIZE) {}
+
+	void randomize(Xoshiro256& rng) {
+		auto uniform = [&](size_t begin, size_t end, float range) {
+			for (size_t i = begin; i < end; i++)params[i] = (float)(((rng() >> 11) * 0x1.0p-53 * 2 - 1) * range);
+		};
+		uniform(W1, B1, 0.1f);
+		uniform(W2, B2, std::sqrt(3.0f / net::HIDDEN1));
+		uniform(PW, PB, std::sqrt(3.0f / net::HIDDEN2));
+		uniform(VW, VB, std::sqrt(3.0f / net::HIDDEN2));
+		for (size_t i = B1; i < W2; i++)params[i] = 0.05f;
+		for (size_t i = B2; i < PW; i++)params[i] = 0.05f;
+	}
+
+	// 量子化で表せる範囲に収める
+	void clip() {
+		for (size_t i = W1; i < B1; i++)params[i] = std::clamp(params[i], -1.0f, 1.0f);
+		const float limit = 127.0f / net::WEIGHT_SCALE;
+		for (size_t i = W2; i < B2; i++)params[i] = std::clamp(params[i], -limit, limit);
+		for (size_t i = PW; i < PB; i++)params[i] = std::clamp(params[i], -limit, limit);
+		for (size_t i = VW; i < VB; i++)params[i] = std::clamp(params[i], -limit, limit);
+	}
+
+	void quantize(net::Weights& q) const {
+		const float a = net::ACTIVATION_SCALE, w = net::WEIGHT_SCALE;
+		auto i8 = [](float x) { return (int8_t)std::clamp(std::lround(x), -127L, 127L); };
+		auto i32 = [](float x) { return (int32_t)std::lround(x); };
+		for (int i = 0; i < net::INPUTS; i++) {
+			for (int j = 0; j < net::HIDDEN1; j++)q.w1[i][j] = i8(params[W1 + i * net::HIDDEN1 + j] * a);
+		}
+		for (int j = 0; j < net::HIDDEN1; j++)q.b1[j] = (int16_t)std::clamp(std::lround(params[B1 + j] * a), -32767L, 32767L);
+		for (int k = 0; k < net::HIDDEN2; k++) {
+			for (int j = 0; j < net::HIDDEN1; j++)q.w2[k][j] = i8(params[W2 + k * net::HIDDEN1 + j] * w);
+			q.b2[k] = i32(params[B2 + k] * a * w);
+		}
+		for (int m = 0; m < net::POLICY; m++) {
+			for (int k = 0; k < net::HIDDEN2; k++)q.policy_w[m][k] = i8(params[PW + m * net::HIDDEN2 + k] * w);
+			q.policy_b[m] = i32(params[PB + m] * a * w);
+		}
+		for (int k = 0; k < net::HIDDEN2; k++)q.value_w[k] = i8(params[VW + k] * w);
+		q.value_b = i32(params[VB] * a * w);
+	}
+
+	void dequantize(const net::Weights& q) {
+		const float a = net::ACTIVATION_SCALE, w = net::WEIGHT_SCALE;
+		for (int i = 0; i < net::INPUTS; i++) {
+			for (int j = 0; j < net::HIDDEN1; j++)params[W1 + i * net::HIDDEN1 + j] = q.w1[i][j] / a;
+		}
+		for (int j = 0; j < net::HIDDEN1; j++)params[B1 + j] = q.b1[j] / a;
+		for (int k = 0; k < net::HIDDEN2; k++) {
+			for (int j = 0; j < net::HIDDEN1; j++)params[W2 + k * net::HIDDEN1 + j] = q.w2[k][j] / w;
+			params[B2 + k] = q.b2[k] / (a * w);
+		}
+		for (int m = 0; m < net::POLICY; m++) {
+			for (int k = 0; k < net::HIDDEN2; k++)params[PW + m * net::HIDDEN2 + k] = q.policy_w[m][k] / w;
+			params[PB + m] = q.policy_b[m] / (a * w);
+		}
+		for (int k = 0; k < net::HIDDEN2; k++)params[VW + k] = q.value_w[k] / w;
+		params[VB] = q.value_b / (a * w);
+	}
+};
+
+struct Losses {
+	double policy = 0;
+	double value = 0;
+	int policy_count = 0;
+	int value_count = 0;
+	int correct = 0; // 方策の 1 位が教師の手と一致した数
+};
+
+// 1 局面分の順伝播と、grad があれば逆伝播
+static void train_step(const FloatNet& model, const NetSample& s, std::vector<float>* grad, Losses& losses) {
+	const std::vector<float>& w = model.params;
+	int active[net::INPUTS], active_count = 0;
+	const uint64_t planes[3] = { s.player, s.opponent, s.legal };
+	for (int plane = 0; plane < 3; plane++) {
+		for (uint64_t b = planes[plane]; b; b &= b - 1)active[active_count++] = plane * bitboard::CELLS + bitboard::lsb(b);
+	}
+
+	float z1[net::HIDDEN1], h1[net::HIDDEN1], z2[net::HIDDEN2], h2[net::HIDDEN2];
+	for (int j = 0; j < net::HIDDEN1; j++)z1[j] = w[FloatNet::B1 + j];
+	for (int a = 0; a < active_count; a++) {
+		const float* row = &w[FloatNet::W1 + active[a] * net::HIDDEN1];
+		for (int j = 0; j < net::HIDDEN1; j++)z1[j] += row[j];
+	}
+	for (int j = 0; j < net::HIDDEN1; j++)h1[j] = std::clamp(z1[j], 0.0f, 1.0f);
+	for (int k = 0; k < net::HIDDEN2; k++) {
+		const float* row = &w[FloatNet::W2 + k * net::HIDDEN1];
+		float sum = w[FloatNet::B2 + k];
+		for (int j = 0; j < net::HIDDEN1; j++)sum += row[j] * h1[j];
+		z2[k] = sum;
+		h2[k] = std::clamp(sum, 0.0f, 1.0f);
+	}
+
+	float dlogit[net::POLICY] = {};
+	if (s.move >= 0) {
+		float logit[net::POLICY], max_logit = -INFINITY;
+		for (int m = 0; m < net::POLICY; m++) {
+			if (!(s.legal >> m & 1))continue;
+			const float* row = &w[FloatNet::PW + m * net::HIDDEN2];
+			float sum = w[FloatNet::PB + m];
+			for (int k = 0; k < net::HIDDEN2; k++)sum += row[k] * h2[k];
+			logit[m] = sum;
+			max_logit = std::max(max_logit, sum);
+		}
+		float total = 0;
+		int best = -1;
+		for (int m = 0; m < net::POLICY; m++) {
+			if (!(s.legal >> m & 1))continue;
+			total += std::exp(logit[m] - max_logit);
+			if (best < 0 || logit[m] > logit[best])best = m;
+		}
+		for (int m = 0; m < net::POLICY; m++) {
+			if (!(s.legal >> m & 1))continue;
+			dlogit[m] = std::exp(logit[m] - max_logit) / total - (m == s.move ? 1.0f : 0.0f);
+		}
+		losses.policy -= logit[s.move] - max_logit - std::log(total);
+		losses.policy_count++;
+		losses.correct += best == s.move;
+	}
+	float value_sum = w[FloatNet::VB];
+	for (int k = 0; k < net::HIDDEN2; k++)value_sum += w[FloatNet::VW + k] * h2[k];
+	float v = std::tanh(value_sum);
+	losses.value += (v - s.result) * (v - s.result);
+	losses.value_count++;
+	if (!grad)return;
+
+	std::vector<float>& g = *grad;
+	float dvalue = 2 * (v - s.result) * (1 - v * v);
+	float dh2[net::HIDDEN2];
+	for (int k = 0; k < net::HIDDEN2; k++) {
+		dh2[k] = dvalue * w[FloatNet::VW + k];
+		g[FloatNet::VW + k] += dvalue * h2[k];
+	}
+	g[FloatNet::VB] += dvalue;
+	for (int m = 0; m < net::POLICY; m++) {
+		if (dlogit[m] == 0)continue;
+		const float* row = &w[FloatNet::PW + m * net::HIDDEN2];
+		float* grow = &g[FloatNet::PW + m * net::HIDDEN2];
+		for (int k = 0; k < net::HIDDEN2; k++) {
+			dh2[k] += dlogit[m] * row[k];
+			grow[k] += dlogit[m] * h2[k];
+		}
+		g[FloatNet::PB + m] += dlogit[m];
+	}
+	float dh1[net::HIDDEN1] = {};
+	for (int k = 0; k < net::HIDDEN2; k++) {
+		float dz = (z2[k] > 0 && z2[k] < 1) ? dh2[k] : 0;
+		if (dz == 0)continue;
+		const float* row = &w[FloatNet::W2 + k * net::HIDDEN1];
+		float* grow = &g[FloatNet::W2 + k * net::HIDDEN1];
+		for (int j = 0; j < net::HIDDEN1; j++) {
+			dh1[j] += dz * row[j];
+			grow[j] += dz * h1[j];
+		}
+		g[FloatNet::B2 + k] += dz;
+	}
+	float dz1[net::HIDDEN1];
+	for (int j = 0; j < net::HIDDEN1; j++)dz1[j] = (z1[j] > 0 && z1[j] < 1) ? dh1[j] : 0;
+	for (int j = 0; j < net::HIDDEN1; j++)g[FloatNet::B1 + j] += dz1[j];
+	for (int a = 0; a < active_count; a++) {
+		float* grow = &g[FloatNet::W1 + active[a] * net::HIDDEN1];
+		for (int j = 0; j < net::HIDDEN1; j++)grow[j] += dz1[j];
+	}
+}
+
+static NetSample transform_sample(const NetSample& s, int symmetry) {
+	NetSample t = s;
+	t.player = bitboard::symmetry(s.player, symmetry);
+	t.opponent = bitboard::symmetry(s.opponent, symmetry);
+	t.legal = bitboard::symmetry(s.legal, symmetry);
+	if (s.move >= 0)t.move = bitboard::lsb(bitboard::symmetry(bitboard::bit(s.move), symmetry));
+	return t;
+}
+
+// エージェント同士の自己対局で局面を集める。epsilon の確率でランダムに打って局面を散らす
+// ランダムな手の乱数は対局ごとに seed ^ game から作り、writer があればその種と一緒に対局を棋譜にも書く
+static std::vector<std::vector<NetSample>> generate_games(const std::string& spec, int games, int threads, double epsilon, uint64_t seed, RecordWriter* writer) {
+	std::vector<std::vector<NetSample>> records(games);
+	std::atomic<int> next_game = 0;
+	auto worker = [&]() {
+		auto agent = make_agent(spec);
+		for (int game; (game = next_game.fetch_add(1)) < games;) {
+			uint64_t game_seed = seed ^ (uint64_t)game;
+			Xoshiro256 rng(game_seed);
+			std::vector<NetSample>& samples = records[game];
+			SearchLimits limits = agent->get_limits();
+			SimpleState state = initial_state();
+			record::GameRecord game_record = { spec, spec, game_seed, 0, 0, {} };
+			while (!state.is_done()) {
+				uint64_t legal = state.legal_moves();
+				if (!legal) {
+					game_record.moves.push_back(bitboard::PASS);
+					state = state.next(bitboard::PASS);
+					continue;
+				}
+				NetSample sample = { state.get_player(), state.get_opponent(), legal, -1, 0 };
+				int pos;
+				if ((rng() >> 11) * 0x1.0p-53 < epsilon) {
+					for (uint32_t k = rng.bounded(bitboard::popcount(legal)); k; k--)legal &= legal - 1;
+					pos = bitboard::lsb(legal);
+				}
+				else {
+					auto action = agent->select_action(state);
+					pos = sample.move = bitboard::to_pos(action.first, action.second);
+				}
+				sample.result = state.teban(); // 終局後に勝敗へ置き換える
+				samples.push_back(sample);
+				game_record.moves.push_back((uint8_t)(sample.move < 0 ? pos | record::MOVE_RANDOM : pos));
+				state = state.next(pos);
+			}
+			agent->set_limits(limits);
+			int diff = state.disc_difference();
+			int last_color = state.teban();
+			for (NetSample& sample : samples) {
+				int d = sample.result == last_color ? diff : -diff;
+				sample.result = (d > 0) - (d < 0);
+			}
+			if (writer) {
+				auto [mine, theirs] = state.stone_count();
+				game_record.black_discs = state.teban() == 0 ? mine : theirs;
+				game_record.white_discs = state.teban() == 0 ? theirs : mine;
+				writer->write(game_record);
+			}
+		}
+	};
+	std::vector<std::thread> pool;
+	for (int i = 1; i < threads; i++)pool.emplace_back(worker);
+	worker();
+	for (auto& thread : pool)thread.join();
+	return records;
+}
+
+static void usage() {
+	std::fprintf(stderr,
+		"usage: train_net [options]\n"
+		"  --games N       self-play games (default 3000)\n"
+		"  --agent SPEC    agent that plays the games and provides the policy target (default ab:iterations=4)\n"
+		"  --epsilon X     probability of a random move (default 0.1)\n"
+		"  --threads N     games played in parallel (default 1)\n"
+		"  --epochs N      passes over the positions (default 4)\n"
+		"  --lr X          Adam learning rate (default 0.002)\n"
+		"  --batch N       positions per update (default 256)\n"
+		"  --init FILE     start from an existing network\n"
+		"  --out FILE      network to write (default %s)\n"
+		"  --weights FILE  pattern weight file used by the agents (default %s)\n"
+		"  --seed N        random seed\n"
+		"  --record FILE   append the self-play games to a game record file\n"
+		"  --records FILE  train on the games in a record file instead of playing new ones\n%s", NET_WEIGHT_FILE, PATTERN_WEIGHT_FILE, AGENT_USAGE);
+}
+
+int main(int argc, char** argv) {
+	int games = 3000, threads = 1, epochs = 4, batch = 256;
+	double epsilon = 0.1, lr = 0.002;
+	std::string spec = "ab:iterations=4", init_path, out_path = NET_WEIGHT_FILE, weights = PATTERN_WEIGHT_FILE, record_path, records_path;
+	uint64_t seed = 1;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			usage();
+			return 1;
+		}
+		std::string value = argv[++i];
+		if (arg == "--games")games = std::atoi(value.c_str());
+		else if (arg == "--agent")spec = value;
+		else if (arg == "--epsilon")epsilon = std::atof(value.c_str());
+		else if (arg == "--threads")threads = std::atoi(value.c_str());
+		else if (arg == "--epochs")epochs = std::atoi(value.c_str());
+		else if (arg == "--lr")lr = std::atof(value.c_str());
+		else if (arg == "--batch")batch = std::atoi(value.c_str());
+		else if (arg == "--init")init_path = value;
+		else if (arg == "--out")out_path = value;
+		else if (arg == "--weights")weights = value;
+		else if (arg == "--seed")seed = std::strtoull(value.c_str(), nullptr, 10);
+		else if (arg == "--record")record_path = value;
+		else if (arg == "--records")records_path = value;
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	// 定跡は使わないと決め、--init のネットがあれば puct の対局にも使う
+	PatternEvaluator::shared(weights);
+	OpeningBook::shared("");
+	const PolicyValueNet* init_net = PolicyValueNet::shared(init_path);
+	if (!init_path.empty() && !init_net) {
+		std::fprintf(stderr, "cannot load %s\n", init_path.c_str());
+		return 1;
+	}
+	if (games < 2 || threads <= 0 || epochs <= 0 || batch <= 0 || !make_agent(spec)) {
+		usage();
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	// 1 割の対局は学習に使わず、汎化の確認に回す
+	std::vector<NetSample> train, validation;
+	if (!records_path.empty()) {
+		RecordReader reader;
+		if (!reader.load(records_path)) {
+			std::fprintf(stderr, "cannot read %s\n", records_path.c_str());
+			return 1;
+		}
+		size_t skipped = record::for_each_position(reader, [&](const record::Position& p) {
+			auto& target = p.game % 10 == 9 ? validation : train;
+			target.push_back({ p.player, p.opponent, p.legal, p.random ? -1 : p.move, (p.result > 0) - (p.result < 0) });
+		});
+		double load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::fprintf(stderr, "loaded %zu games (%zu skipped), %zu positions in %.1f s\n", reader.size() - skipped, skipped, train.size() + validation.size(), load_seconds);
+	}
+	else {
+		RecordWriter writer;
+		if (!record_path.empty() && !writer.open(record_path)) {
+			std::fprintf(stderr, "cannot open %s\n", record_path.c_str());
+			return 1;
+		}
+		auto records = generate_games(spec, games, threads, epsilon, seed, writer.is_open() ? &writer : nullptr);
+		double generate_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		for (int game = 0; game < games; game++) {
+			auto& target = game % 10 == 9 ? validation : train;
+			target.insert(target.end(), records[game].begin(), records[game].end());
+		}
+		std::fprintf(stderr, "generated %d games, %zu positions in %.1f s\n", games, train.size() + validation.size(), generate_seconds);
+	}
+	if (train.empty()) {
+		std::fprintf(stderr, "no positions to train on\n");
+		return 1;
+	}
+
+	Xoshiro256 rng(seed);
+	FloatNet model;
+	if (init_net) {
+		MappedFile file;
+		file.open(init_path);
+		model.dequantize(*(const net::Weights*)(file.data() + sizeof(net::FileHeader)));
+	}
+	else {
+		model.randomize(rng);
+	}
+
+	std::vector<float> grad(FloatNet::SIZE), m(FloatNet::SIZE), v(FloatNet::SIZE);
+	const double beta1 = 0.9, beta2 = 0.999;
+	int step = 0;
+	for (int epoch = 1; epoch <= epochs; epoch++) {
+		for (size_t i = train.size() - 1; i > 0; i--)std::swap(train[i], train[rng.bounded((uint32_t)i + 1)]);
+		Losses losses;
+		for (size_t begin = 0; begin < train.size(); begin += batch) {
+			size_t end = std::min(train.size(), begin + batch);
+			std::fill(grad.begin(), grad.end(), 0.0f);
+			for (size_t i = begin; i < end; i++) {
+				train_step(model, transform_sample(train[i], rng.bounded(bitboard::SYMMETRY_COUNT)), &grad, losses);
+			}
+			step++;
+			const double scale = 1.0 / (end - begin);
+			const double correction = std::sqrt(1 - std::pow(beta2, step)) / (1 - std::pow(beta1, step));
+			for (size_t i = 0; i < FloatNet::SIZE; i++) {
+				double g = grad[i] * scale;
+				m[i] = (float)(beta1 * m[i] + (1 - beta1) * g);
+				v[i] = (float)(beta2 * v[i] + (1 - beta2) * g * g);
+				model.params[i] -= (float)(lr * correction * m[i] / (std::sqrt(v[i]) + 1e-8));
+			}
+			model.clip();
+		}
+		Losses check;
+		for (const NetSample& s : validation)train_step(model, s, nullptr, check);
+		std::fprintf(stderr, "epoch %d  train policy %.3f value %.3f  validation policy %.3f value %.3f top1 %.1f%%\n", epoch,
+			losses.policy / std::max(1, losses.policy_count), losses.value / std::max(1, losses.value_count),
+			check.policy / std::max(1, check.policy_count), check.value / std::max(1, check.value_count),
+			100.0 * check.correct / std::max(1, check.policy_count));
+	}
+
+	auto quantized = std::make_unique<net::Weights>();
+	model.quantize(*quantized);
+	if (!net::write_file(out_path, *quantized)) {
+		std::fprintf(stderr, "cannot write %s\n", out_path.c_str());
+		return 1;
+	}
+
+	// 書き出したファイルを推論側で読み直し、量子化後の一致率を確かめる
+	PolicyValueNet written;
+	if (!written.load(out_path)) {
+		std::fprintf(stderr, "cannot read back %s\n", out_path.c_str());
+		return 1;
+	}
+	int correct = 0, count = 0;
+	double value_error = 0;
+	for (const NetSample& s : validation) {
+		float policy[net::POLICY], value;
+		written.evaluate(s.player, s.opponent, s.legal, policy, value);
+		value_error += (value - s.result) * (value - s.result);
+		if (s.move < 0)continue;
+		int best = -1;
+		for (uint64_t b = s.legal; b; b &= b - 1) {
+			int pos = bitboard::lsb(b);
+			if (best < 0 || policy[pos] > policy[best])best = pos;
+		}
+		correct += best == s.move;
+		count++;
+	}
+	std::printf("wrote %s (%zu bytes)\n", out_path.c_str(), sizeof(net::FileHeader) + sizeof(net::Weights));
+	std::printf("int8   validation value %.3f top1 %.1f%%\n", value_error / std::max<size_t>(1, validation.size()), 100.0 * correct / std::max(1, count));
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+﻿// 自己対局でパターン評価の重みを TD(λ) で学習し、重みファイルに書く
+#include "EngineDefine.h"
+#include "PatternEvaluator.cpp"
+#include "Playout.cpp"
+#include "SelfPlay.cpp"
+#include <cstdio>
+
+class PatternTrainer {
+private:
+	struct Sample {
+		uint64_t player;
+		uint64_t opponent;
+		int sign; // 手番が黒なら 1、白なら -1
+	};
+
+	std::vector<float> weights; // 石差の単位
+	Xoshiro256 rng;
+
+	float* stage_weights(uint64_t p, uint64_t o) {
+		return weights.data() + (size_t)pattern::stage(p, o) * pattern::LAYOUT.weight_count;
+	}
+
+	float value(uint64_t p, uint64_t o) {
+		int indices[pattern::LAYOUT.instance_count];
+		int count = pattern::feature_indices(p, o, indices);
+		const float* w = stage_weights(p, o);
+		float v = 0;
+		for (int i = 0; i < count; i++)v += w[indices[i]];
+		return v;
+	}
+
+	// 予測が error の alpha 倍だけ動くように重みを直す。空きマスばかりの形は同じ重みを何度も引くので、その重複を数えて割る
+	void update(uint64_t p, uint64_t o, float alpha, float error) {
+		int indices[pattern::LAYOUT.instance_count];
+		int count = pattern::feature_indices(p, o, indices);
+		std::sort(indices, indices + count);
+		int norm = 0;
+		for (int i = 0, j; i < count; i = j) {
+			for (j = i; j < count && indices[j] == indices[i]; j++);
+			norm += (j - i) * (j - i);
+		}
+		float step = alpha * error / norm;
+		float* w = stage_weights(p, o);
+		for (int i = 0; i < count; i++)w[indices[i]] += step;
+	}
+
+	// epsilon の確率でランダム、それ以外は 1 手読みで評価値が最もよい手を打つ
+	int choose_move(uint64_t p, uint64_t o, uint64_t moves, double epsilon) {
+		int n = bitboard::popcount(moves);
+		if ((rng() >> 11) * 0x1.0p-53 < epsilon) {
+			for (uint32_t k = rng.bounded(n); k; k--)moves &= moves - 1;
+			return bitboard::lsb(moves);
+		}
+		int best = bitboard::lsb(moves);
+		float best_value = 1e30f;
+		for (; moves; moves &= moves - 1) {
+			uint64_t move = moves & (0 - moves);
+			uint64_t f = bitboard::flips(p, o, move);
+			float v = value(o & ~f, p | move | f);
+			if (v < best_value) {
+				best_value = v;
+				best = bitboard::lsb(move);
+			}
+		}
+		return best;
+	}
+
+public:
+	explicit PatternTrainer(uint64_t seed) :weights((size_t)pattern::STAGE_COUNT * pattern::LAYOUT.weight_count), rng(seed) {}
+
+	bool load(const std::string& path) {
+		PatternEvaluator evaluator;
+		if (!evaluator.load(path))return false;
+		MappedFile file;
+		file.open(path);
+		const int16_t* w = (const int16_t*)(file.data() + sizeof(pattern::FileHeader));
+		for (size_t i = 0; i < weights.size(); i++)weights[i] = w[i] / (float)pattern::SCALE;
+		return true;
+	}
+
+	bool save(const std::string& path) const {
+		std::vector<int16_t> quantized(weights.size());
+		for (size_t i = 0; i < weights.size(); i++) {
+			quantized[i] = (int16_t)std::clamp(std::lround(weights[i] * pattern::SCALE), -32767L, 32767L);
+		}
+		return pattern::write_file(path, quantized);
+	}
+
+	// 1 局打って学習し、各局面の予測と結果の差の二乗平均を返す
+	double train_game(double alpha, double lambda, double epsilon) {
+		std::vector<Sample> samples;
+		SimpleState state = initial_state();
+		while (!state.is_done()) {
+			uint64_t moves = state.legal_moves();
+			if (!moves) {
+				state = state.next(bitboard::PASS);
+				continue;
+			}
+			uint64_t p = state.get_player(), o = state.get_opponent();
+			samples.push_back({ p, o, state.teban() == 0 ? 1 : -1 });
+			state = state.next(choose_move(p, o, moves, epsilon));
+		}
+		auto [mine, theirs] = state.stone_count();
+		float result = (float)(state.teban() == 0 ? mine - theirs : theirs - mine); // 黒から見た石差
+
+		// 後ろから λ-return を作る: G_t = (1 - λ) V(s_{t+1}) + λ G_{t+1}
+		double squared_error = 0;
+		float target = result;
+		for (int t = (int)samples.size() - 1; t >= 0; t--) {
+			const Sample& s = samples[t];
+			float v = value(s.player, s.opponent);
+			float error = s.sign * target - v;
+			squared_error += error * error;
+			update(s.player, s.opponent, (float)alpha, error);
+			target = (float)(lambda * target + (1 - lambda) * s.sign * v);
+		}
+		return samples.empty() ? 0 : squared_error / samples.size();
+	}
+};
+
+static void usage() {
+	std::fprintf(stderr,
+		"usage: train_pattern [options]\n"
+		"  --games N        self-play games (default 100000)\n"
+		"  --alpha X        fraction of the error corrected per position (default 0.1)\n"
+		"  --lambda X       TD(lambda) (default 0.7)\n"
+		"  --epsilon X      probability of a random move (default 0.1)\n"
+		"  --init FILE      start from an existing weight file\n"
+		"  --out FILE       weight file to write (default %s)\n"
+		"  --seed N         random seed\n", PATTERN_WEIGHT_FILE);
+}
+
+int main(int argc, char** argv) {
+	int games = 100000;
+	double alpha = 0.1, lambda = 0.7, epsilon = 0.1;
+	std::string init_path, out_path = PATTERN_WEIGHT_FILE;
+	uint64_t seed = 1;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			usage();
+			return 1;
+		}
+		std::string value = argv[++i];
+		if (arg == "--games")games = std::atoi(value.c_str());
+		else if (arg == "--alpha")alpha = std::atof(value.c_str());
+		else if (arg == "--lambda")lambda = std::atof(value.c_str());
+		else if (arg == "--epsilon")epsilon = std::atof(value.c_str());
+		else if (arg == "--init")init_path = value;
+		else if (arg == "--out")out_path = value;
+		else if (arg == "--seed")seed = std::strtoull(value.c_str(), nullptr, 10);
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	PatternTrainer trainer(seed);
+	if (!init_path.empty() && !trainer.load(init_path)) {
+		std::fprintf(stderr, "cannot load %s\n", init_path.c_str());
+		return 1;
+	}
+	const int report_every = std::max(1, games / 20);
+	double error_sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int game = 1; game <= games; game++) {
+		error_sum += trainer.train_game(alpha, lambda, epsilon);
+		if (game % report_every == 0 || game == games) {
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::fprintf(stderr, "%8d games  mse %8.2f  %.0f games/s\n", game, error_sum / report_every, game / seconds);
+			error_sum = 0;
+			if (!trainer.save(out_path)) {
+				std::fprintf(stderr, "cannot write %s\n", out_path.c_str());
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
\ No newline at end of file